@@ -0,0 +1,518 @@
+/* gdxArrow.c
+ * code for gdxrrw::rgdx.arrow:
+ * read a symbol from GDX into Arrow C data interface structs
+ *
+ * Copyright (c) 2010-2021 GAMS Development Corp. <support@gams.com>
+ * Copyright (c) 2010-2021 GAMS Software GmbH <support@gams.com>
+ *
+ * This program and the accompanying materials are made available
+ * under the terms of the Eclipse Public License 2.0 which is
+ * available at  http://www.eclipse.org/legal/epl-2.0.
+ *
+ * This Source Code may also be made available under the following
+ * Secondary Licenses when the conditions for such availability set
+ * forth in the Eclipse Public License, v. 2.0 are satisfied:
+ * GNU General Public License, version 2 or later
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR GPL-2.0-or-later
+ */
+
+#include <R.h>
+#include <Rinternals.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <limits.h>
+
+#include "gdxcc.h"
+#include "gclgms.h"
+#include "globals.h"
+
+/* the Arrow C data interface, as given in the Arrow format spec, so
+ * consumers (nanoarrow, arrow, DuckDB, pyarrow) can take our structs.
+ * INT64 from gdxcc.h stands in for int64_t: <stdint.h> clashes with
+ * the uint64_t typedef in globals.h
+ */
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+struct ArrowSchema {
+  const char *format;
+  const char *name;
+  const char *metadata;
+  INT64 flags;
+  INT64 n_children;
+  struct ArrowSchema **children;
+  struct ArrowSchema *dictionary;
+  void (*release)(struct ArrowSchema *);
+  void *private_data;
+};
+
+struct ArrowArray {
+  INT64 length;
+  INT64 null_count;
+  INT64 offset;
+  INT64 n_buffers;
+  INT64 n_children;
+  const void **buffers;
+  struct ArrowArray **children;
+  struct ArrowArray *dictionary;
+  void (*release)(struct ArrowArray *);
+  void *private_data;
+};
+
+#endif  /* ARROW_C_DATA_INTERFACE */
+
+/* arrowCalloc: calloc that raises an exception on failure */
+static void *
+arrowCalloc (size_t n, size_t size)
+{
+  void *p;
+
+  p = calloc ((n > 0) ? n : 1, size);
+  if (NULL == p)
+    error ("memory exhaustion error: could not allocate Arrow buffer");
+  return p;
+} /* arrowCalloc */
+
+/* arrowStrdup: copy of s in malloc'd memory, NULL for NULL */
+static char *
+arrowStrdup (const char *s)
+{
+  char *t;
+
+  if (NULL == s)
+    return NULL;
+  t = arrowCalloc (strlen(s) + 1, 1);
+  strcpy (t, s);
+  return t;
+} /* arrowStrdup */
+
+/* releaseSchema: release callback for all schemas made here
+ * everything a schema points to is malloc'd, also for partly built ones
+ */
+static void
+releaseSchema (struct ArrowSchema *s)
+{
+  INT64 k;
+
+  for (k = 0;  k < s->n_children;  k++) {
+    if (NULL == s->children[k])
+      continue;
+    if (s->children[k]->release)
+      s->children[k]->release (s->children[k]);
+    free (s->children[k]);
+  }
+  free (s->children);
+  if (s->dictionary) {
+    if (s->dictionary->release)
+      s->dictionary->release (s->dictionary);
+    free (s->dictionary);
+  }
+  free ((void *) s->format);
+  free ((void *) s->name);
+  s->release = NULL;
+} /* releaseSchema */
+
+/* releaseArray: release callback for all arrays made here
+ * children moved out by the consumer have release == NULL already
+ */
+static void
+releaseArray (struct ArrowArray *a)
+{
+  INT64 k;
+
+  for (k = 0;  k < a->n_children;  k++) {
+    if (NULL == a->children[k])
+      continue;
+    if (a->children[k]->release)
+      a->children[k]->release (a->children[k]);
+    free (a->children[k]);
+  }
+  free (a->children);
+  if (a->dictionary) {
+    if (a->dictionary->release)
+      a->dictionary->release (a->dictionary);
+    free (a->dictionary);
+  }
+  for (k = 0;  k < a->n_buffers;  k++)
+    free ((void *) a->buffers[k]);
+  free (a->buffers);
+  a->release = NULL;
+} /* releaseArray */
+
+/* initSchema: fill the zeroed schema s in place
+ * s must already be reachable from an external pointer, so that a
+ * failure here leaves nothing behind that the finalizer cannot free
+ */
+static void
+initSchema (struct ArrowSchema *s, const char *format, const char *name,
+            int nChildren)
+{
+  int k;
+
+  s->release = releaseSchema;
+  s->format = arrowStrdup (format);
+  s->name = arrowStrdup (name);
+  s->children = arrowCalloc (nChildren, sizeof(*s->children));
+  s->n_children = nChildren;
+  for (k = 0;  k < nChildren;  k++)
+    s->children[k] = arrowCalloc (1, sizeof(**s->children));
+} /* initSchema */
+
+/* initArray: fill the zeroed array a in place, as initSchema does */
+static void
+initArray (struct ArrowArray *a, int nBuffers, int nChildren)
+{
+  int k;
+
+  a->release = releaseArray;
+  a->buffers = arrowCalloc (nBuffers, sizeof(*a->buffers));
+  a->n_buffers = nBuffers;
+  a->children = arrowCalloc (nChildren, sizeof(*a->children));
+  a->n_children = nChildren;
+  for (k = 0;  k < nChildren;  k++)
+    a->children[k] = arrowCalloc (1, sizeof(**a->children));
+} /* initArray */
+
+/* arrowSchemaFinalizer: release the schema unless it was moved out */
+static void
+arrowSchemaFinalizer (SEXP ptr)
+{
+  struct ArrowSchema *s;
+
+  s = (struct ArrowSchema *) R_ExternalPtrAddr (ptr);
+  if (NULL == s)
+    return;
+  if (s->release)
+    s->release (s);
+  free (s);
+  R_ClearExternalPtr (ptr);
+} /* arrowSchemaFinalizer */
+
+/* arrowArrayFinalizer: release the array unless it was moved out */
+static void
+arrowArrayFinalizer (SEXP ptr)
+{
+  struct ArrowArray *a;
+
+  a = (struct ArrowArray *) R_ExternalPtrAddr (ptr);
+  if (NULL == a)
+    return;
+  if (a->release)
+    a->release (a);
+  free (a);
+  R_ClearExternalPtr (ptr);
+} /* arrowArrayFinalizer */
+
+/* mkArrowPtr: return an external pointer of class cls owning a zeroed
+ * struct of size siz, released and freed by fin
+ */
+static SEXP
+mkArrowPtr (const char *cls, size_t siz, R_CFinalizer_t fin)
+{
+  SEXP ptr;
+
+  PROTECT(ptr = R_MakeExternalPtr (NULL, install(cls), R_NilValue));
+  R_RegisterCFinalizerEx (ptr, fin, TRUE);
+  R_SetExternalPtrAddr (ptr, arrowCalloc (1, siz));
+  setAttrib(ptr, R_ClassSymbol, mkString(cls));
+  UNPROTECT(1);
+  return ptr;
+} /* mkArrowPtr */
+
+/* setDictionary: make the utf8 array dict from the UEL strings in uels */
+static void
+setDictionary (struct ArrowArray *dict, SEXP uels)
+{
+  int *offsets;
+  char *data;
+  const char *s;
+  size_t nBytes, len;
+  int n, k;
+
+  n = length(uels);
+  initArray (dict, 3, 0);
+  for (nBytes = 0, k = 0;  k < n;  k++)
+    nBytes += strlen(translateCharUTF8(STRING_ELT(uels, k)));
+  if (nBytes > INT_MAX)
+    error ("UEL dictionary is too large for an Arrow utf8 array");
+  offsets = arrowCalloc (n+1, sizeof(*offsets));
+  dict->buffers[1] = offsets;
+  data = arrowCalloc (nBytes, 1);
+  dict->buffers[2] = data;
+  for (nBytes = 0, k = 0;  k < n;  k++) {
+    offsets[k] = (int) nBytes;
+    s = translateCharUTF8(STRING_ELT(uels, k));
+    len = strlen(s);
+    memcpy (data + nBytes, s, len);
+    nBytes += len;
+  }
+  offsets[n] = (int) nBytes;
+  dict->length = n;
+} /* setDictionary */
+
+/* colName: store in name the Arrow name for column k given base,
+ * following patchNames in R for '*' and make.unique for repeats
+ */
+static void
+colName (const char *base, int k, int nIdx, SEXP names, char name[])
+{
+  const char *defNames[] = {".i", ".j", ".k"};
+  int kk, nSame;
+
+  if (0 == strcmp(base, "*")) {
+    if (nIdx <= 3)
+      strcpy (name, defNames[k]);
+    else
+      sprintf (name, ".i%d", k+1);
+  }
+  else
+    strcpy (name, base);
+  for (nSame = 0, kk = 0;  kk < k;  kk++) {
+    if (0 == strcmp(name, CHAR(STRING_ELT(names, kk))))
+      nSame++;
+  }
+  if (nSame)
+    sprintf (name + strlen(name), ".%d", nSame);
+  SET_STRING_ELT(names, k, mkChar(name));
+} /* colName */
+
+/* rgdxArrow: gateway function for reading a symbol into an Arrow
+ * struct array, called from R via .External
+ * first argument <- gdx file name
+ * second argument <- symbol name
+ * third argument <- field(s) to read for variables and equations
+ * fourth argument <- squeeze specifier
+ * fifth argument <- useDomInfo specifier
+ * return: list(schema, array) of external pointers to an ArrowSchema
+ *   and ArrowArray, with an int32 dictionary column per index position
+ *   and a float64 column per field
+ */
+SEXP
+rgdxArrow (SEXP args)
+{
+  const char *funcName = "rgdx.arrow";
+  SEXP fileName, symNameExp, fieldExp, squeezeExp, udi;
+  SEXP targs, schemaPtr, arrayPtr, fileCache, uels, domains, names;
+  SEXP outList, outNames;
+  shortStringBuf_t gdxFileName, symName;
+  char symText[GMS_SSSIZE], name[GMS_SSSIZE+16];
+  char *fields[] = {"l", "m", "lo", "up", "s", "all"};
+  struct ArrowSchema *schema;
+  struct ArrowArray *array;
+  int *idxBuf[GMS_MAX_INDEX_DIM];
+  double *valBuf[GMS_VAL_MAX];
+  xpFilter_t xpFilter[GMS_MAX_INDEX_DIM];
+  gdxUelIndex_t uelIdx;
+  gdxValues_t values;
+  int outIdx[GMS_MAX_INDEX_DIM];
+  fieldSet_t fs;
+  dField_t dField;
+  double defVal = 0;
+  int symIdx, symDim, symType, symNNZ, symUser, typeCode = 0;
+  int nRecs, iRec, kRec, nVals, nCols, changeIdx, findrc, domInfoCode;
+  int iDim, k, kk;
+  Rboolean squeezeDef, squeeze, useDomInfo;
+
+  if (6 != length(args)) {
+    error ("usage: %s(gdxName, symName, field, squeeze, useDomInfo)"
+           " - incorrect arg count", funcName);
+  }
+  targs = CDR(args);
+  fileName       = CAR(targs);  targs = CDR(targs);
+  symNameExp     = CAR(targs);  targs = CDR(targs);
+  fieldExp       = CAR(targs);  targs = CDR(targs);
+  squeezeExp     = CAR(targs);  targs = CDR(targs);
+  udi            = CAR(targs);  targs = CDR(targs);
+  if (TYPEOF(fileName) != STRSXP) {
+    error ("usage: %s(gdxName, symName) - gdxName must be a string", funcName);
+  }
+  if (TYPEOF(symNameExp) != STRSXP) {
+    error ("usage: %s(gdxName, symName) - symName must be a string", funcName);
+  }
+  if ((TYPEOF(fieldExp) != STRSXP) || (length(fieldExp) < 1) ||
+      (length(fieldExp) > GMS_VAL_MAX)) {
+    error ("usage: %s(gdxName, symName, field) - field must be a string"
+           " or a vector of distinct fields", funcName);
+  }
+  fs.n = 0;
+  for (k = 0;  k < length(fieldExp);  k++) {
+    for (dField = level;  dField <= all;  dField++) {
+      if (0 == strcasecmp(fields[dField], CHAR(STRING_ELT(fieldExp, k))))
+        break;
+    }
+    if (dField > all) {
+      error ("usage: %s(gdxName, symName, field) - field must be in"
+             " ['l','m','lo','up','s','all']", funcName);
+    }
+    if ((all == dField) && (length(fieldExp) > 1)) {
+      error ("usage: %s(gdxName, symName, field) - field='all' cannot be"
+             " combined with other fields", funcName);
+    }
+    for (kk = 0;  kk < fs.n;  kk++) {
+      if (fs.idx[kk] == (int) dField)
+        error ("usage: %s(gdxName, symName, field) - field '%s' given more"
+               " than once", funcName, fields[dField]);
+    }
+    if (all == dField) {
+      for (fs.n = 0;  fs.n < GMS_VAL_MAX;  fs.n++)
+        fs.idx[fs.n] = fs.n;
+    }
+    else
+      fs.idx[fs.n++] = dField;
+  }
+  squeezeDef = exp2Boolean (squeezeExp);
+  if (NA_LOGICAL == squeezeDef) {
+    error ("usage: %s(gdxName, symName, field, squeeze = TRUE)\n    squeeze argument could not be interpreted as logical", funcName);
+  }
+  useDomInfo = exp2Boolean (udi);
+  if (NA_LOGICAL == useDomInfo) {
+    error ("usage: %s(gdxName, symName, field, squeeze = TRUE, useDomInfo = TRUE)\n    useDomInfo argument could not be interpreted as logical", funcName);
+  }
+  (void) CHAR2ShortStr (CHAR(STRING_ELT(fileName, 0)), gdxFileName);
+  checkStringLength (CHAR(STRING_ELT(symNameExp, 0)));
+
+  openGDXRead (gdxFileName);
+  if (! gdxFindSymbol (gdxHandle, CHAR(STRING_ELT(symNameExp, 0)), &symIdx)) {
+    error ("GDX file %s contains no symbol named '%s'", gdxFileName,
+           CHAR(STRING_ELT(symNameExp, 0)));
+  }
+  gdxSymbolInfo (gdxHandle, symIdx, symName, &symDim, &symType);
+  gdxSymbolInfoX (gdxHandle, symIdx, &symNNZ, &symUser, symText);
+  if (GMS_DT_ALIAS == symType) { /* follow link to actual set */
+    symIdx = symUser;
+    gdxSymbolInfo (gdxHandle, symIdx, symName, &symDim, &symType);
+    gdxSymbolInfoX (gdxHandle, symIdx, &symNNZ, &symUser, symText);
+  }
+  squeeze = FALSE;
+  switch (symType) {
+  case GMS_DT_SET:
+    nVals = 0;                  /* index columns only */
+    break;
+  case GMS_DT_PAR:
+    nVals = 1;
+    fs.n = 1;
+    fs.idx[0] = GMS_VAL_LEVEL;
+    squeeze = squeezeDef;
+    break;
+  case GMS_DT_VAR:
+  case GMS_DT_EQU:
+    typeCode = (GMS_DT_VAR == symType) ?
+      gmsFixVarType (symUser) : gmsFixEquType (symUser);
+    if (typeCode < 0) {
+      error ("Symbol '%s' has no associated type", symName);
+    }
+    nVals = fs.n;
+    if (1 == nVals) {           /* as rgdx: squeeze single fields only */
+      squeeze = squeezeDef;
+      defVal = getDefVal (symType, typeCode, (dField_t) fs.idx[0]);
+    }
+    break;
+  default:
+    error ("GDX symbol %s is not recognized as set, parameter, variable,"
+           " or equation", symName);
+  }
+  nCols = symDim + nVals;
+
+  /* the column names and dictionaries come from the same UEL filters
+   * that rgdx uses for $domains and $uels */
+  memset (xpFilter, 0, sizeof(xpFilter));
+  PROTECT(fileCache = allocVector(VECSXP, FCACHE_LEN));
+  SET_VECTOR_ELT(fileCache, FCACHE_FILEID, mkFileId (gdxFileName));
+  PROTECT(uels = allocVector(VECSXP, symDim));
+  PROTECT(domains = allocVector(STRSXP, symDim));
+  mkXPFilter (symIdx, useDomInfo, xpFilter, domains, &domInfoCode, fileCache);
+  for (iDim = 0;  iDim < symDim;  iDim++) {
+    if (identity == xpFilter[iDim].fType) {
+      getUniverse (fileCache);
+      break;
+    }
+  }
+  xpFilterToUels (symDim, xpFilter, VECTOR_ELT(fileCache, FCACHE_UNIVERSE),
+                  uels);
+  PROTECT(names = allocVector(STRSXP, nCols));
+  for (k = 0;  k < symDim;  k++)
+    colName (CHAR(STRING_ELT(domains, k)), k, symDim, names, name);
+  for (k = 0;  k < nVals;  k++) {
+    colName ((GMS_DT_PAR == symType) ? "value" : fields[fs.idx[k]],
+             symDim + k, symDim, names, name);
+  }
+
+  /* from here on, the finalizers free whatever was built if we fail */
+  PROTECT(schemaPtr = mkArrowPtr ("gdxArrowSchema", sizeof(*schema),
+                                  arrowSchemaFinalizer));
+  PROTECT(arrayPtr = mkArrowPtr ("gdxArrowArray", sizeof(*array),
+                                 arrowArrayFinalizer));
+  schema = (struct ArrowSchema *) R_ExternalPtrAddr (schemaPtr);
+  array = (struct ArrowArray *) R_ExternalPtrAddr (arrayPtr);
+  initSchema (schema, "+s", "", nCols);
+  initArray (array, 1, nCols);
+  if (! gdxDataReadRawStart (gdxHandle, symIdx, &nRecs))
+    error ("Could not gdxDataReadRawStart");
+  for (k = 0;  k < symDim;  k++) {
+    initSchema (schema->children[k], "i", CHAR(STRING_ELT(names, k)), 0);
+    schema->children[k]->dictionary =
+      arrowCalloc (1, sizeof(*schema->children[k]->dictionary));
+    initSchema (schema->children[k]->dictionary, "u", NULL, 0);
+    initArray (array->children[k], 2, 0);
+    idxBuf[k] = arrowCalloc (nRecs, sizeof(*idxBuf[k]));
+    array->children[k]->buffers[1] = idxBuf[k];
+    array->children[k]->dictionary =
+      arrowCalloc (1, sizeof(*array->children[k]->dictionary));
+    setDictionary (array->children[k]->dictionary, VECTOR_ELT(uels, k));
+  }
+  for (k = 0;  k < nVals;  k++) {
+    kk = symDim + k;
+    initSchema (schema->children[kk], "g", CHAR(STRING_ELT(names, kk)), 0);
+    initArray (array->children[kk], 2, 0);
+    valBuf[k] = arrowCalloc (nRecs, sizeof(*valBuf[k]));
+    array->children[kk]->buffers[1] = valBuf[k];
+  }
+
+  /* one pass over the records, straight into the Arrow buffers */
+  for (kRec = 0, iRec = 0;  iRec < nRecs;  iRec++) {
+    gdxDataReadRaw (gdxHandle, uelIdx, values, &changeIdx);
+    findrc = findInXPFilter (symDim, uelIdx, xpFilter, outIdx);
+    if (findrc) {
+      (void) gdxDataReadDone (gdxHandle);
+      error ("DEBUG 00: findrc = %d is unhandled", findrc);
+    }
+    if (squeeze && (defVal == values[fs.idx[0]]))
+      continue;
+    for (k = 0;  k < symDim;  k++)
+      idxBuf[k][kRec] = outIdx[k] - 1;
+    for (k = 0;  k < nVals;  k++)
+      valBuf[k][kRec] = values[fs.idx[k]];
+    kRec++;
+  } /* loop over GDX records */
+  if (!gdxDataReadDone (gdxHandle)) {
+    error ("Could not gdxDataReadDone");
+  }
+  for (iDim = 0;  iDim < symDim;  iDim++) {
+    free (xpFilter[iDim].idx);
+    free (xpFilter[iDim].lookup.pos);
+  }
+  if (gdxClose (gdxHandle) != 0) {
+    error("Errors detected when closing gdx file");
+  }
+  (void) gdxFree (&gdxHandle);
+
+  array->length = kRec;
+  for (k = 0;  k < nCols;  k++)
+    array->children[k]->length = kRec;
+
+  PROTECT(outList = allocVector(VECSXP, 2));
+  PROTECT(outNames = allocVector(STRSXP, 2));
+  SET_VECTOR_ELT(outList, 0, schemaPtr);
+  SET_VECTOR_ELT(outList, 1, arrayPtr);
+  SET_STRING_ELT(outNames, 0, mkChar("schema"));
+  SET_STRING_ELT(outNames, 1, mkChar("array"));
+  setAttrib(outList, R_NamesSymbol, outNames);
+  UNPROTECT(8);
+  return outList;
+} /* rgdxArrow */
@@ -0,0 +1,426 @@
+/* gdxIterate.c
+ * code for gdxrrw::gdxIterate and gdxrrw::nextChunk:
+ * read a symbol from GDX in chunks of records
+ *
+ * Copyright (c) 2010-2021 GAMS Development Corp. <support@gams.com>
+ * Copyright (c) 2010-2021 GAMS Software GmbH <support@gams.com>
+ *
+ * This program and the accompanying materials are made available
+ * under the terms of the Eclipse Public License 2.0 which is
+ * available at  http://www.eclipse.org/legal/epl-2.0.
+ *
+ * This Source Code may also be made available under the following
+ * Secondary Licenses when the conditions for such availability set
+ * forth in the Eclipse Public License, v. 2.0 are satisfied:
+ * GNU General Public License, version 2 or later
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR GPL-2.0-or-later
+ */
+
+#include <R.h>
+#include <Rinternals.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <limits.h>
+
+#include "gdxcc.h"
+#include "gclgms.h"
+#include "globals.h"
+
+/* elements of the chunk template kept with the iterator */
+#define ITER_VAL 3              /* position of $val: set for each chunk */
+
+typedef struct gdxIterator {    /* symbol being read in chunks */
+  gdxHandle_t h;                /* GDX file, in read mode until done */
+  int symDim;
+  int symType;
+  int nVals;                    /* values per record: 0, 1, or GMS_VAL_MAX */
+  int valField;                 /* field to store if nVals == 1 */
+  int squeeze;                  /* skip records with valField == defVal */
+  double defVal;
+  int chunk;                    /* records per chunk */
+  int nRecs;                    /* records in the symbol */
+  int iRec;                     /* records read so far */
+  int done;                     /* all records read, or aborted */
+  xpFilter_t xpFilter[GMS_MAX_INDEX_DIM];
+} gdxIterator_t;
+
+/* gdxIteratorFinalizer: close the GDX file when the iterator is collected */
+static void
+gdxIteratorFinalizer (SEXP ptr)
+{
+  gdxIterator_t *it;
+  int iDim;
+
+  it = (gdxIterator_t *) R_ExternalPtrAddr (ptr);
+  if (NULL == it)
+    return;
+  if (gdxHandle == it->h)
+    gdxHandle = (gdxHandle_t) 0;
+  if (! it->done)
+    (void) gdxDataReadDone (it->h);
+  (void) gdxClose (it->h);
+  (void) gdxFree (&it->h);
+  for (iDim = 0;  iDim < GMS_MAX_INDEX_DIM;  iDim++) {
+    free (it->xpFilter[iDim].idx);
+    free (it->xpFilter[iDim].lookup.pos);
+  }
+  free (it);
+  R_ClearExternalPtr (ptr);
+} /* gdxIteratorFinalizer */
+
+/* getIterator: return the iterator held in ptr,
+ * raising an exception if ptr is not a usable gdxIterator
+ */
+static gdxIterator_t *
+getIterator (SEXP ptr)
+{
+  gdxIterator_t *it;
+
+  if ((EXTPTRSXP != TYPEOF(ptr)) ||
+      (install("gdxIterator") != R_ExternalPtrTag (ptr)))
+    error ("Expected a gdxIterator object");
+  it = (gdxIterator_t *) R_ExternalPtrAddr (ptr);
+  if (NULL == it)
+    error ("gdxIterator is no longer valid (e.g. it was restored from a saved session)");
+  return it;
+} /* getIterator */
+
+/* mkChunkTemplate: return the rgdx list for the symbol, except $val,
+ * shared by all chunks returned by nextChunk
+ */
+static SEXP
+mkChunkTemplate (gdxIterator_t *it, const char *gdxFileName,
+                 const char *symName, int symIdx,
+                 int typeCode, dField_t dField, Rboolean useDomInfo)
+{
+  SEXP tmpl, tmplNames, fileCache, uels, domains, fieldUels;
+  char *types[] = {"set", "parameter", "variable", "equation"};
+  char *fields[] = {"l", "m", "lo", "up", "s", "all"};
+  char *domInfoSrc;
+  const char *eltNames[11];
+  int domInfoCode, iDim, symDimX, nElts, k;
+
+  symDimX = it->symDim;
+  if (GMS_VAL_MAX == it->nVals)
+    symDimX++;                  /* additional 'field' index */
+  PROTECT(fileCache = allocVector(VECSXP, FCACHE_LEN));
+  SET_VECTOR_ELT(fileCache, FCACHE_FILEID, mkFileId (gdxFileName));
+  PROTECT(uels = allocVector(VECSXP, symDimX));
+  PROTECT(domains = allocVector(STRSXP, symDimX));
+  mkXPFilter (symIdx, useDomInfo, it->xpFilter, domains, &domInfoCode,
+              fileCache);
+  for (iDim = 0;  iDim < it->symDim;  iDim++) {
+    if (identity == it->xpFilter[iDim].fType) {
+      getUniverse (fileCache);
+      break;
+    }
+  }
+  xpFilterToUels (it->symDim, it->xpFilter,
+                  VECTOR_ELT(fileCache, FCACHE_UNIVERSE), uels);
+  if (symDimX > it->symDim) {
+    PROTECT(fieldUels = allocVector(STRSXP, GMS_VAL_MAX));
+    for (k = 0;  k < GMS_VAL_MAX;  k++)
+      SET_STRING_ELT(fieldUels, k, mkChar(fields[k]));
+    SET_VECTOR_ELT(uels, it->symDim, fieldUels);
+    SET_STRING_ELT(domains, it->symDim, mkChar("_field"));
+    UNPROTECT(1);
+  }
+  switch (domInfoCode) {
+  case 1:
+    domInfoSrc = "none";
+    break;
+  case 2:
+    domInfoSrc = "relaxed";
+    break;
+  case 3:
+    domInfoSrc = "full";
+    break;
+  default:
+    domInfoSrc = "NA";
+  }
+
+  nElts = 0;
+  eltNames[nElts++] = "name";
+  eltNames[nElts++] = "type";
+  eltNames[nElts++] = "dim";
+  eltNames[nElts++] = "val";
+  eltNames[nElts++] = "form";
+  eltNames[nElts++] = "uels";
+  eltNames[nElts++] = "domains";
+  eltNames[nElts++] = "domInfo";
+  if ((GMS_DT_VAR == it->symType) || (GMS_DT_EQU == it->symType)) {
+    eltNames[nElts++] = "field";
+    if (GMS_DT_VAR == it->symType)
+      eltNames[nElts++] = "varTypeText";
+    eltNames[nElts++] = "typeCode";
+  }
+  PROTECT(tmpl = allocVector(VECSXP, nElts));
+  PROTECT(tmplNames = allocVector(STRSXP, nElts));
+  for (k = 0;  k < nElts;  k++)
+    SET_STRING_ELT(tmplNames, k, mkChar(eltNames[k]));
+  setAttrib(tmpl, R_NamesSymbol, tmplNames);
+  k = 0;
+  SET_VECTOR_ELT(tmpl, k++, mkString(symName));
+  SET_VECTOR_ELT(tmpl, k++, mkString(types[it->symType]));
+  SET_VECTOR_ELT(tmpl, k++, ScalarInteger(it->symDim));
+  k++;                          /* $val is set per chunk */
+  SET_VECTOR_ELT(tmpl, k++, mkString("sparse"));
+  SET_VECTOR_ELT(tmpl, k++, uels);
+  SET_VECTOR_ELT(tmpl, k++, domains);
+  SET_VECTOR_ELT(tmpl, k++, mkString(domInfoSrc));
+  if ((GMS_DT_VAR == it->symType) || (GMS_DT_EQU == it->symType)) {
+    SET_VECTOR_ELT(tmpl, k++, mkString(fields[dField]));
+    if (GMS_DT_VAR == it->symType)
+      SET_VECTOR_ELT(tmpl, k++, mkString(gmsVarTypeText[typeCode]));
+    SET_VECTOR_ELT(tmpl, k++, ScalarInteger(typeCode));
+  }
+  UNPROTECT(5);
+  return tmpl;
+} /* mkChunkTemplate */
+
+/* gdxIterate: gateway function for starting a chunked read of a symbol,
+ * called from R via .External
+ * first argument <- gdx file name
+ * second argument <- symbol name
+ * third argument <- records per chunk
+ * fourth argument <- field to read for variables and equations
+ * fifth argument <- squeeze specifier
+ * sixth argument <- useDomInfo specifier
+ * return: external pointer of class gdxIterator, to pass to nextChunk
+ */
+SEXP
+gdxIterate (SEXP args)
+{
+  const char *funcName = "gdxIterate";
+  SEXP fileName, symNameExp, chunkExp, fieldExp, squeezeExp, udi;
+  SEXP targs, ptr, cls;
+  shortStringBuf_t gdxFileName, symName;
+  char symText[GMS_SSSIZE];
+  char *fields[] = {"l", "m", "lo", "up", "s", "all"};
+  gdxIterator_t *it;
+  dField_t dField;
+  double chunk;
+  int symIdx, symDim, symType, symNNZ, symUser, typeCode = 0;
+  Rboolean squeezeDef, useDomInfo;
+
+  if (7 != length(args)) {
+    error ("usage: %s(gdxName, symName, chunk, field, squeeze, useDomInfo)"
+           " - incorrect arg count", funcName);
+  }
+  targs = CDR(args);
+  fileName       = CAR(targs);  targs = CDR(targs);
+  symNameExp     = CAR(targs);  targs = CDR(targs);
+  chunkExp       = CAR(targs);  targs = CDR(targs);
+  fieldExp       = CAR(targs);  targs = CDR(targs);
+  squeezeExp     = CAR(targs);  targs = CDR(targs);
+  udi            = CAR(targs);  targs = CDR(targs);
+  if (TYPEOF(fileName) != STRSXP) {
+    error ("usage: %s(gdxName, symName) - gdxName must be a string", funcName);
+  }
+  if (TYPEOF(symNameExp) != STRSXP) {
+    error ("usage: %s(gdxName, symName) - symName must be a string", funcName);
+  }
+  chunk = asReal(chunkExp);
+  if (ISNAN(chunk) || (chunk < 1) || (chunk > INT_MAX)) {
+    error ("usage: %s(gdxName, symName, chunk) - chunk must be a positive count",
+           funcName);
+  }
+  if (TYPEOF(fieldExp) != STRSXP) {
+    error ("usage: %s(gdxName, symName, chunk, field) - field must be a string",
+           funcName);
+  }
+  for (dField = level;  dField <= all;  dField++) {
+    if (0 == strcasecmp(fields[dField], CHAR(STRING_ELT(fieldExp, 0))))
+      break;
+  }
+  if (dField > all) {
+    error ("usage: %s(gdxName, symName, chunk, field) - field must be in"
+           " ['l','m','lo','up','s','all']", funcName);
+  }
+  squeezeDef = exp2Boolean (squeezeExp);
+  if (NA_LOGICAL == squeezeDef) {
+    error ("usage: %s(gdxName, symName, chunk, field, squeeze = TRUE)\n    squeeze argument could not be interpreted as logical", funcName);
+  }
+  useDomInfo = exp2Boolean (udi);
+  if (NA_LOGICAL == useDomInfo) {
+    error ("usage: %s(gdxName, symName, chunk, field, squeeze = TRUE, useDomInfo = TRUE)\n    useDomInfo argument could not be interpreted as logical", funcName);
+  }
+  (void) CHAR2ShortStr (CHAR(STRING_ELT(fileName, 0)), gdxFileName);
+  checkStringLength (CHAR(STRING_ELT(symNameExp, 0)));
+
+  openGDXRead (gdxFileName);
+  it = malloc(sizeof(*it));
+  if (NULL == it)
+    error ("memory exhaustion error: could not allocate gdxIterator");
+  memset (it, 0, sizeof(*it));
+  it->h = gdxHandle;
+  it->done = 1;                 /* not reading yet */
+  /* from here on, the finalizer closes the file if we fail */
+  PROTECT(ptr = R_MakeExternalPtr (it, install("gdxIterator"), R_NilValue));
+  R_RegisterCFinalizerEx (ptr, gdxIteratorFinalizer, TRUE);
+
+  if (! gdxFindSymbol (gdxHandle, CHAR(STRING_ELT(symNameExp, 0)), &symIdx)) {
+    error ("GDX file %s contains no symbol named '%s'", gdxFileName,
+           CHAR(STRING_ELT(symNameExp, 0)));
+  }
+  gdxSymbolInfo (gdxHandle, symIdx, symName, &symDim, &symType);
+  gdxSymbolInfoX (gdxHandle, symIdx, &symNNZ, &symUser, symText);
+  if (GMS_DT_ALIAS == symType) { /* follow link to actual set */
+    symIdx = symUser;
+    gdxSymbolInfo (gdxHandle, symIdx, symName, &symDim, &symType);
+    gdxSymbolInfoX (gdxHandle, symIdx, &symNNZ, &symUser, symText);
+  }
+  it->symDim = symDim;
+  it->symType = symType;
+  it->chunk = (int) chunk;
+  it->nVals = 1;
+  it->valField = GMS_VAL_LEVEL;
+  switch (symType) {
+  case GMS_DT_SET:
+    it->nVals = 0;              /* no squeeze for a set */
+    break;
+  case GMS_DT_PAR:
+    it->squeeze = squeezeDef;
+    break;
+  case GMS_DT_VAR:
+  case GMS_DT_EQU:
+    typeCode = (GMS_DT_VAR == symType) ?
+      gmsFixVarType (symUser) : gmsFixEquType (symUser);
+    if (typeCode < 0) {
+      error ("Symbol '%s' has no associated type", symName);
+    }
+    if (all == dField)
+      it->nVals = GMS_VAL_MAX;
+    else {
+      it->valField = dField;
+      it->squeeze = squeezeDef;
+      it->defVal = getDefVal (symType, typeCode, dField);
+    }
+    break;
+  default:
+    error ("GDX symbol %s is not recognized as set, parameter, variable,"
+           " or equation", symName);
+  }
+  if ((GMS_DT_VAR != symType) && (GMS_DT_EQU != symType))
+    dField = level;
+  R_SetExternalPtrProtected (ptr, mkChunkTemplate (it, gdxFileName, symName,
+                                                   symIdx, typeCode, dField,
+                                                   useDomInfo));
+  PROTECT(cls = allocVector(STRSXP, 1));
+  SET_STRING_ELT(cls, 0, mkChar("gdxIterator"));
+  setAttrib(ptr, R_ClassSymbol, cls);
+
+  if (! gdxDataReadRawStart (gdxHandle, symIdx, &it->nRecs))
+    error ("Could not gdxDataReadRawStart");
+  it->done = 0;
+  gdxHandle = (gdxHandle_t) 0;
+  UNPROTECT(2);
+  return ptr;
+} /* gdxIterate */
+
+/* nextChunk: gateway function for reading the next chunk of records
+ * from a gdxIterator, called from R via .External
+ * first argument <- gdxIterator
+ * return: the next records in rgdx sparse form, or NULL if there are no more
+ */
+SEXP
+nextChunk (SEXP args)
+{
+  const char *funcName = "nextChunk";
+  SEXP ptr, tmpl, val, outList;
+  gdxIterator_t *it;
+  gdxUelIndex_t uels;
+  gdxValues_t values;
+  int outIdx[GMS_MAX_INDEX_DIM];
+  int mrows, nCols, kRec, kk, changeIdx, findrc, nLeft;
+  R_xlen_t index;               /* offset into $val, may be a long vector */
+  double *p;
+
+  if (2 != length(args)) {
+    error ("usage: %s(it) - incorrect arg count", funcName);
+  }
+  ptr = CADR(args);
+  it = getIterator (ptr);
+  if (it->done)
+    return R_NilValue;
+
+  nLeft = it->nRecs - it->iRec;
+  mrows = (nLeft < it->chunk) ? nLeft : it->chunk;
+  nCols = it->symDim + 1;
+  if (0 == it->nVals)
+    nCols = it->symDim;         /* no data col */
+  else if (GMS_VAL_MAX == it->nVals) {
+    nCols++;                    /* additional 'field' col */
+    mrows = sparseAllRows (mrows, GMS_VAL_MAX);
+  }
+  PROTECT(val = allocMatrix(REALSXP, mrows, nCols));
+  p = REAL(val);
+  for (kRec = 0;  (kRec < mrows) && (it->iRec < it->nRecs);  ) {
+    gdxDataReadRaw (it->h, uels, values, &changeIdx);
+    it->iRec++;
+    findrc = findInXPFilter (it->symDim, uels, it->xpFilter, outIdx);
+    if (findrc) {
+      it->done = 1;
+      (void) gdxDataReadDone (it->h);
+      error ("DEBUG 00: findrc = %d is unhandled", findrc);
+    }
+    if (it->squeeze && (it->defVal == values[it->valField]))
+      continue;
+    if (GMS_VAL_MAX == it->nVals) {
+      for (index = kRec, kk = 0;  kk < it->symDim;  kk++) {
+        p[index+GMS_VAL_LEVEL   ] = outIdx[kk];
+        p[index+GMS_VAL_MARGINAL] = outIdx[kk];
+        p[index+GMS_VAL_LOWER   ] = outIdx[kk];
+        p[index+GMS_VAL_UPPER   ] = outIdx[kk];
+        p[index+GMS_VAL_SCALE   ] = outIdx[kk];
+        index += mrows;
+      }
+      for (kk = 0;  kk < GMS_VAL_MAX;  kk++) {
+        p[index+kk] = 1 + kk;
+        p[index+mrows+kk] = values[kk];
+      }
+      kRec += GMS_VAL_MAX;
+      continue;
+    }
+    for (index = kRec, kk = 0;  kk < it->symDim;  kk++) {
+      p[index] = outIdx[kk];
+      index += mrows;
+    }
+    if (it->nVals)
+      p[index] = values[it->valField];
+    kRec++;
+  } /* loop over GDX records */
+  if (it->iRec >= it->nRecs) {
+    it->done = 1;
+    if (!gdxDataReadDone (it->h)) {
+      error ("Could not gdxDataReadDone");
+    }
+  }
+  if (0 == kRec) {
+    UNPROTECT(1);
+    return R_NilValue;          /* only squeezed records were left */
+  }
+  if (kRec < mrows) {
+    SEXP newVal;
+
+    PROTECT(newVal = allocMatrix(REALSXP, kRec, nCols));
+    for (kk = 0;  kk < nCols;  kk++) {
+      MEMCPY (REAL(newVal) + (size_t)kk*kRec, p + (size_t)kk*mrows,
+              sizeof(*p)*kRec);
+    }
+    UNPROTECT(2);
+    PROTECT(val = newVal);
+  }
+
+  /* shallow copy of the template, with this chunk as $val */
+  tmpl = R_ExternalPtrProtected (ptr);
+  PROTECT(outList = allocVector(VECSXP, length(tmpl)));
+  for (kk = 0;  kk < length(tmpl);  kk++)
+    SET_VECTOR_ELT(outList, kk, VECTOR_ELT(tmpl, kk));
+  SET_VECTOR_ELT(outList, ITER_VAL, val);
+  setAttrib(outList, R_NamesSymbol, getAttrib(tmpl, R_NamesSymbol));
+  UNPROTECT(2);
+  return outList;
+} /* nextChunk */
@@ -0,0 +1,125 @@
+/* gdxReader.c
+ * code for gdxrrw::gdxReader: a GDX file held open across rgdx calls
+ *
+ * Copyright (c) 2010-2021 GAMS Development Corp. <support@gams.com>
+ * Copyright (c) 2010-2021 GAMS Software GmbH <support@gams.com>
+ *
+ * This program and the accompanying materials are made available
+ * under the terms of the Eclipse Public License 2.0 which is
+ * available at  http://www.eclipse.org/legal/epl-2.0.
+ *
+ * This Source Code may also be made available under the following
+ * Secondary Licenses when the conditions for such availability set
+ * forth in the Eclipse Public License, v. 2.0 are satisfied:
+ * GNU General Public License, version 2 or later
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR GPL-2.0-or-later
+ */
+
+#include <R.h>
+#include <Rinternals.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "gdxcc.h"
+#include "gclgms.h"
+#include "globals.h"
+
+/* gdxReaderFinalizer: close the GDX file when the reader is collected */
+static void
+gdxReaderFinalizer (SEXP ptr)
+{
+  gdxReader_t *rdr;
+
+  rdr = (gdxReader_t *) R_ExternalPtrAddr (ptr);
+  if (NULL == rdr)
+    return;
+  if (gdxHandle == rdr->h)
+    gdxHandle = (gdxHandle_t) 0;
+  (void) gdxClose (rdr->h);
+  (void) gdxFree (&rdr->h);
+  free (rdr);
+  R_ClearExternalPtr (ptr);
+} /* gdxReaderFinalizer */
+
+/* getGdxReader: return the reader held in ptr,
+ * raising an exception if ptr is not a usable gdxReader
+ */
+gdxReader_t *
+getGdxReader (SEXP ptr)
+{
+  gdxReader_t *rdr;
+
+  if ((EXTPTRSXP != TYPEOF(ptr)) ||
+      (install("gdxReader") != R_ExternalPtrTag (ptr)))
+    error ("Expected a gdxReader object");
+  rdr = (gdxReader_t *) R_ExternalPtrAddr (ptr);
+  if (NULL == rdr)
+    error ("gdxReader is no longer valid (e.g. it was restored from a saved session)");
+  return rdr;
+} /* getGdxReader */
+
+/* gdxReaderBegin: make the reader's GDX handle the current one
+ * A read that was aborted by an error leaves the handle in
+ * read mode, so reset it before starting over.
+ */
+void
+gdxReaderBegin (gdxReader_t *rdr)
+{
+  if (rdr->busy)
+    (void) gdxDataReadDone (rdr->h);
+  rdr->busy = 1;
+  gdxHandle = rdr->h;
+} /* gdxReaderBegin */
+
+/* gdxReaderEnd: mark a read via the reader as successfully completed */
+void
+gdxReaderEnd (gdxReader_t *rdr)
+{
+  rdr->busy = 0;
+  gdxHandle = (gdxHandle_t) 0;
+} /* gdxReaderEnd */
+
+/* gdxReader: gateway function for opening a GDX file to be read
+ * by multiple rgdx calls, called from R via .External
+ * first argument <- gdx file name
+ * return: external pointer of class gdxReader,
+ *   the file is closed when this is garbage collected
+ */
+SEXP
+gdxReader (SEXP args)
+{
+  const char *funcName = "gdxReader";
+  SEXP fileName, ptr, fileCache, cls;
+  shortStringBuf_t gdxFileName;
+  gdxReader_t *rdr;
+
+  if (2 != length(args)) {
+    error ("usage: %s(gdxName) - incorrect arg count", funcName);
+  }
+  fileName = CADR(args);
+  if (TYPEOF(fileName) != STRSXP) {
+    error ("usage: %s(gdxName) - gdxName must be a string", funcName);
+  }
+  (void) CHAR2ShortStr (CHAR(STRING_ELT(fileName, 0)), gdxFileName);
+
+  openGDXRead (gdxFileName);
+  rdr = malloc(sizeof(*rdr));
+  if (NULL == rdr)
+    error ("memory exhaustion error: could not allocate gdxReader");
+  memset (rdr, 0, sizeof(*rdr));
+  rdr->h = gdxHandle;
+  gdxHandle = (gdxHandle_t) 0;
+  (void) CHAR2ShortStr (gdxFileName, rdr->fileName);
+
+  /* the universe and domain sets are read on demand by rgdx and kept here */
+  PROTECT(fileCache = allocVector(VECSXP, FCACHE_LEN));
+  SET_VECTOR_ELT(fileCache, FCACHE_FILEID, mkFileId (gdxFileName));
+  PROTECT(ptr = R_MakeExternalPtr (rdr, install("gdxReader"), fileCache));
+  R_RegisterCFinalizerEx (ptr, gdxReaderFinalizer, TRUE);
+  PROTECT(cls = allocVector(STRSXP, 1));
+  SET_STRING_ELT(cls, 0, mkChar("gdxReader"));
+  setAttrib(ptr, R_ClassSymbol, cls);
+  UNPROTECT(3);
+  return ptr;
+} /* gdxReader */
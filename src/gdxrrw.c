@@ -88,6 +88,13 @@ getNonZeroElements (gdxHandle_t h, int symIdx, dField_t dField);
 
 
 /* -------------------- Methods definition-----------------------*/
+/* R_init_gdxrrw: called by R when the package DLL is loaded */
+void
+R_init_gdxrrw (DllInfo *dll)
+{
+  initLazyVal (dll);
+} /* R_init_gdxrrw */
+
 #if defined(_WIN32)
 static char lastErrorMsgBuf[128];
 static const char *formatMessage(int errNum);
@@ -19,6 +19,8 @@
 #if ! defined(_GDXRRW_GLOBALS_H_)
 #define       _GDXRRW_GLOBALS_H_
 
+#include <R_ext/Rdynload.h>
+
 #if defined(_WIN32)
 # include <windows.h>
 #else
@@ -28,6 +30,11 @@
 
 #define LINELEN 1024
 #define MAX_STRING 128
+/* elements of the per-file cache shared by all reads from an open GDX file */
+#define FCACHE_UNIVERSE 0       /* STRSXP of all UELs */
+#define FCACHE_DOMSETS  1       /* VECSXP: UEL indices of domain sets, by symIdx */
+#define FCACHE_FILEID   2       /* RAWSXP identifying the file version, see uelCache.c */
+#define FCACHE_LEN      3
 #if defined(__linux__) && defined(__x86_64)
 /* long story: GLIBC hacked up memcpy on my Fedora 15 machine
  * so GLIBC 2.14 is required to use the gdxrrw.so.  That is not acceptable.
@@ -61,17 +68,50 @@ typedef enum dField {
   all = GMS_VAL_MAX,
   max = GMS_VAL_MAX + 1
 } dField_t;
+typedef struct fieldSet {       /* fields read when dField == all */
+  int n;                        /* GMS_VAL_MAX for field='all' */
+  int idx[GMS_VAL_MAX];         /* GMS_VAL_LEVEL etc., in output order */
+} fieldSet_t;
+typedef struct valPred {        /* rgdx 'where': value test for each record */
+  int withGt;                   /* value > gt */
+  double gt;
+  int withAbsGt;                /* |value| > absGt */
+  double absGt;
+  int withBetween;              /* lo <= value <= hi */
+  double lo, hi;
+  int finiteOnly;               /* value is not NA, NaN or +/-Inf */
+} valPred_t;
+typedef enum aggOp {            /* rgdx 'agg': how to combine records */
+  aggNone = 0,
+  aggSum,
+  aggMin,
+  aggMax,
+  aggMean,
+  aggCount
+} aggOp_t;
 typedef struct rSpec {          /* rgdx read specifier */
   char name[1024];
   dForm_t dForm;
-  dField_t dField;
+  dField_t dField;              /* all: the fields in 'fields' */
+  fieldSet_t fields;
   int withField;
   int compress;
   int ts;
   int te;
   int withUel;
+  int withSlice;
+  int intIndex;                 /* sparse $val as integer index vectors + values */
+  int lazy;                     /* $val read on first access */
+  int withWhere;                /* keep only records passing 'where' */
+  valPred_t where;
+  aggOp_t agg;                  /* aggregate over the positions not kept */
+  int nKeep;                    /* index positions kept with 'agg' */
+  int keep[GMS_MAX_INDEX_DIM];  /* one-based, in output order */
+  int asMatrix;                 /* form='Matrix': $val as a CSC sparse matrix */
+  int wide;                     /* layout='wide': a row per record, a col per field */
   int dim;
   SEXP filterUel;
+  SEXP slice;                   /* list of fixed UELs, NULL for free positions */
 } rSpec_t;
 typedef struct wSpec {
   char name[1024];
@@ -85,7 +125,14 @@ typedef struct wSpec {
   int dim;                      /* as read from input list element 'dim' */
   int symDim;                   /* consistent with GDX or GAMS idea of symbol dim */
   int typeCode;                 /* to send to GDX */
+  int wide;                     /* layout='wide': a value col per field */
+  int nValCols;                 /* var/equ: sparse 'val' cols after the index cols */
 } wSpec_t;
+typedef struct gdxReader {      /* GDX file held open across rgdx calls */
+  gdxHandle_t h;
+  shortStringBuf_t fileName;
+  int busy;                     /* read in progress or aborted by an error */
+} gdxReader_t;
 typedef unsigned long long int uint64_t;
 typedef union d64 {
   double x;
@@ -101,12 +148,28 @@ typedef enum domainType {
   relaxed,
   regular
 } domainType_t;
+typedef enum readEngine {       /* how rgdx gets records from GDX */
+  rawEngine = 0,                /* gdxDataReadRaw, filtering done here */
+  filteredEngine,               /* registered GDX filters + gdxDataReadMap */
+  fastEngine                    /* gdxDataReadRawFast callback */
+} readEngine_t;
+/* FilterAction codes for gdxDataReadFilteredStart:
+ * positive values are filter numbers */
+#define GDX_DOMC_UNMAPPED -2
+#define GDX_DOMC_EXPAND   -1
+#define GDX_DOMC_STRICT    0
+typedef struct uelLookup {      /* maps uel index to 1 + position in a filter */
+  int *pos;                     /* lookup table, NULL if not built */
+  int posLen;                   /* length of pos */
+  int isDense;                  /* pos indexed directly by uel, o/w a hash table */
+} uelLookup_t;
 typedef struct hpFilter {       /* high-performance filter */
   int *idx;                     /* actual data: uel indices to select */
   int n;                        /* number of elements in filter */
   int isOrdered;                /* is the data ordered? */
   int prevPos;                  /* previous position of successful search */
   filterType_t fType;
+  uelLookup_t lookup;           /* uel index -> position in idx */
 } hpFilter_t;
 typedef struct xpFilter {       /* xtreme-performance filter */
   int *idx;                     /* actual data: uel indices to select */
@@ -114,6 +177,7 @@ typedef struct xpFilter {       /* xtreme-performance filter */
   int prevPos;                  /* previous position of successful search */
   filterType_t fType;
   domainType_t domType;         /* what type of domain info was the source? */
+  uelLookup_t lookup;           /* uel index -> position in idx, for large domains */
 } xpFilter_t;
 
 GDX_FUNCPTR(gdxGetLoadPath);
@@ -136,6 +200,58 @@ gams (SEXP args);
 /* ********** functions in rgdx.c *********************** */
 SEXP
 rgdx (SEXP args);
+SEXP
+rgdxAll (SEXP args);
+SEXP
+getUniverse (SEXP fileCache);
+SEXP
+readLazyVal (SEXP reader, SEXP request, Rboolean squeezeDef,
+             Rboolean useDomInfo);
+
+
+/* ********** functions in gdxReader.c ****************** */
+SEXP
+gdxReader (SEXP args);
+gdxReader_t *
+getGdxReader (SEXP ptr);
+void
+gdxReaderBegin (gdxReader_t *rdr);
+void
+gdxReaderEnd (gdxReader_t *rdr);
+
+
+/* ********** functions in gdxIterate.c ***************** */
+SEXP
+gdxIterate (SEXP args);
+SEXP
+nextChunk (SEXP args);
+
+
+/* ********** functions in gdxArrow.c ******************* */
+SEXP
+rgdxArrow (SEXP args);
+
+
+/* ********** functions in lazyVal.c ******************** */
+void
+initLazyVal (DllInfo *dll);
+SEXP
+mkLazyVal (SEXP reader, SEXP request, Rboolean squeeze, Rboolean useDomInfo,
+           R_xlen_t len);
+
+
+/* ********** functions in symToDF.c ******************** */
+SEXP
+symToDF (SEXP args);
+
+
+/* ********** functions in uelCache.c ******************* */
+SEXP
+mkFileId (const char *gdxFileName);
+SEXP
+uelCacheGet (SEXP fileId);
+void
+uelCachePut (SEXP fileId, SEXP universe);
 
 
 /* ********** functions in wgdx.c *********************** */
@@ -150,6 +266,10 @@ void
 checkFileExtension (shortStringBuf_t fileName);
 void
 checkStringLength (const char *str);
+const char *
+uelString (SEXP uni, int k, shortStringBuf_t buf);
+SEXP
+uelCHARSXP (SEXP uni, int k);
 void
 compressData (int symDim, int mRows, SEXP uni, int nUni, xpFilter_t filterList[],
               SEXP spVals, SEXP uels);
@@ -160,7 +280,7 @@ void
 mkHPFilter (SEXP uFilter, hpFilter_t *hpf);
 void
 mkXPFilter (int symIdx, Rboolean useDomInfo, xpFilter_t filterList[],
-            SEXP outDomains, int *domInfoCode);
+            SEXP outDomains, int *domInfoCode, SEXP fileCache);
 void
 prepHPFilter (int symDim, hpFilter_t filterList[]);
 int
@@ -177,12 +297,11 @@ getDomainNames (int symIdx, Rboolean useDomInfo,
 char *
 getGlobalString (const char *globName, shortStringBuf_t result);
 int
-getNonDefaultElemCount (gdxHandle_t h, int symIdx,
-                        int symType, int symSubType, dField_t dField);
-int
 getNonZeroElements (gdxHandle_t h, int symIdx, dField_t dField);
 Rboolean
 getInventSetText (Rboolean defVal);
+readEngine_t
+getReadEngine (void);
 Rboolean
 exp2Boolean (SEXP exp);
 int
@@ -190,10 +309,21 @@ isCompress (void);
 void
 loadGDX (void);
 void
+openGDXRead (shortStringBuf_t gdxFileName);
+void
 makeStrVec (SEXP outExp, SEXP inExp);
 void
 sparseToFull (SEXP spVal, SEXP fullVal, SEXP uelLists,
-              int symType, int symSubType, dField_t dField, int nRec, int symDimX);
+              int symType, int symSubType, dField_t dField,
+              const fieldSet_t *fields, Rboolean wide, int nRec,
+              int symDimX);
+int
+sparseAllRows (int nRecs, int nFields);
+void
+initFullVal (double *pFull, R_xlen_t fullCard, int symType, int symSubType,
+             dField_t dField, const fieldSet_t *fields);
+void
+allFields (fieldSet_t *fields);
 void
 getDefRecEqu (int subType, double defRec[]);
 void
@@ -0,0 +1,143 @@
+/* lazyVal.c
+ * code for lazy rgdx results: $val is an ALTREP vector whose records
+ * are read from the GDX file on first access
+ *
+ * Copyright (c) 2010-2021 GAMS Development Corp. <support@gams.com>
+ * Copyright (c) 2010-2021 GAMS Software GmbH <support@gams.com>
+ *
+ * This program and the accompanying materials are made available
+ * under the terms of the Eclipse Public License 2.0 which is
+ * available at  http://www.eclipse.org/legal/epl-2.0.
+ *
+ * This Source Code may also be made available under the following
+ * Secondary Licenses when the conditions for such availability set
+ * forth in the Eclipse Public License, v. 2.0 are satisfied:
+ * GNU General Public License, version 2 or later
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR GPL-2.0-or-later
+ */
+
+#include <R.h>
+#include <Rinternals.h>
+#include <Rversion.h>
+#include <R_ext/Rdynload.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "gdxcc.h"
+#include "gclgms.h"
+#include "globals.h"
+
+/* elements of data1 of a lazy $val, i.e. how to read it */
+#define LAZY_READER     0       /* gdxReader holding the file open */
+#define LAZY_REQUEST    1       /* read specifier, without 'lazy' */
+#define LAZY_SQUEEZE    2
+#define LAZY_USEDOMINFO 3
+#define LAZY_LENGTH     4       /* length of $val, as a double */
+#define LAZY_LEN        5
+
+#if R_VERSION >= R_Version(3, 6, 0)
+# define WITH_ALTREP
+# include <R_ext/Altrep.h>
+
+static R_altrep_class_t lazyValClass;
+
+/* lazyMaterialize: return the $val that the lazy vector x stands for,
+ * reading it from GDX on first use
+ */
+static SEXP
+lazyMaterialize (SEXP x)
+{
+  SEXP state, val;
+
+  val = R_altrep_data2 (x);
+  if (R_NilValue != val)
+    return val;
+  state = R_altrep_data1 (x);
+  PROTECT(val = readLazyVal (VECTOR_ELT(state, LAZY_READER),
+                             VECTOR_ELT(state, LAZY_REQUEST),
+                             LOGICAL(VECTOR_ELT(state, LAZY_SQUEEZE))[0],
+                             LOGICAL(VECTOR_ELT(state, LAZY_USEDOMINFO))[0]));
+  if (XLENGTH(val) != (R_xlen_t) REAL(VECTOR_ELT(state, LAZY_LENGTH))[0])
+    error ("lazy rgdx read: the symbol in the GDX file has changed");
+  R_set_altrep_data2 (x, val);
+  UNPROTECT(1);
+  return val;
+} /* lazyMaterialize */
+
+static R_xlen_t
+lazyLength (SEXP x)
+{
+  return (R_xlen_t) REAL(VECTOR_ELT(R_altrep_data1 (x), LAZY_LENGTH))[0];
+} /* lazyLength */
+
+static void *
+lazyDataptr (SEXP x, Rboolean writeable)
+{
+  return REAL(lazyMaterialize (x));
+} /* lazyDataptr */
+
+static const void *
+lazyDataptrOrNull (SEXP x)
+{
+  SEXP val = R_altrep_data2 (x);
+
+  return (R_NilValue == val) ? NULL : REAL(val);
+} /* lazyDataptrOrNull */
+
+static double
+lazyElt (SEXP x, R_xlen_t i)
+{
+  return REAL(lazyMaterialize (x))[i];
+} /* lazyElt */
+
+static Rboolean
+lazyInspect (SEXP x, int pre, int deep, int pvec,
+             void (*inspectSubtree)(SEXP, int, int, int))
+{
+  Rprintf (" gdxrrw lazy $val (%s)\n",
+           (R_NilValue == R_altrep_data2 (x)) ? "not yet read" : "read");
+  return TRUE;
+} /* lazyInspect */
+#endif /* R_VERSION >= 3.6.0 */
+
+/* initLazyVal: register the ALTREP class for lazy $val,
+ * called when the package DLL is loaded
+ */
+void
+initLazyVal (DllInfo *dll)
+{
+#if defined(WITH_ALTREP)
+  lazyValClass = R_make_altreal_class ("lazyVal", "gdxrrw", dll);
+  R_set_altrep_Length_method (lazyValClass, lazyLength);
+  R_set_altrep_Inspect_method (lazyValClass, lazyInspect);
+  R_set_altvec_Dataptr_method (lazyValClass, lazyDataptr);
+  R_set_altvec_Dataptr_or_null_method (lazyValClass, lazyDataptrOrNull);
+  R_set_altreal_Elt_method (lazyValClass, lazyElt);
+#endif
+} /* initLazyVal */
+
+/* mkLazyVal: return a double vector of length len, to be read on first
+ * access by calling readLazyVal with the remaining args
+ */
+SEXP
+mkLazyVal (SEXP reader, SEXP request, Rboolean squeeze, Rboolean useDomInfo,
+           R_xlen_t len)
+{
+#if defined(WITH_ALTREP)
+  SEXP state, x;
+
+  PROTECT(state = allocVector(VECSXP, LAZY_LEN));
+  SET_VECTOR_ELT(state, LAZY_READER, reader);
+  SET_VECTOR_ELT(state, LAZY_REQUEST, request);
+  SET_VECTOR_ELT(state, LAZY_SQUEEZE, ScalarLogical(squeeze));
+  SET_VECTOR_ELT(state, LAZY_USEDOMINFO, ScalarLogical(useDomInfo));
+  SET_VECTOR_ELT(state, LAZY_LENGTH, ScalarReal((double) len));
+  x = R_new_altrep (lazyValClass, state, R_NilValue);
+  UNPROTECT(1);
+  return x;
+#else
+  error ("lazy=TRUE requires R 3.6.0 or later");
+  return R_NilValue;
+#endif
+} /* mkLazyVal */
@@ -28,6 +28,85 @@
 #include "gclgms.h"
 #include "globals.h"
 
+/* whereNum: return element k of the numeric 'where' entry exp */
+static double
+whereNum (SEXP exp, const char *eltName, int len, int k)
+{
+  if (((REALSXP != TYPEOF(exp)) && (INTSXP != TYPEOF(exp))) ||
+      (length(exp) != len))
+    error ("Input list element 'where$%s' must be numeric of length %d",
+           eltName, len);
+  if (REALSXP == TYPEOF(exp))
+    return REAL(exp)[k];
+  if (NA_INTEGER == INTEGER(exp)[k])
+    return NA_REAL;
+  return INTEGER(exp)[k];
+} /* whereNum */
+
+/* checkWhere: check the 'where' element of a read specifier
+ * and store the value tests it asks for in w
+ */
+static void
+checkWhere (SEXP whereExp, valPred_t *w)
+{
+  SEXP whereNames, exp;
+  const char *eltName;
+  int i;
+
+  whereNames = getAttrib(whereExp, R_NamesSymbol);
+  if ((VECSXP != TYPEOF(whereExp)) || (R_NilValue == whereNames))
+    error ("Input list element 'where' must be a named list");
+  for (i = 0;  i < length(whereExp);  i++) {
+    eltName = CHAR(STRING_ELT(whereNames, i));
+    exp = VECTOR_ELT(whereExp, i);
+    if (0 == strcmp("gt", eltName)) {
+      w->withGt = 1;
+      w->gt = whereNum (exp, eltName, 1, 0);
+    }
+    else if (0 == strcmp("abs_gt", eltName)) {
+      w->withAbsGt = 1;
+      w->absGt = whereNum (exp, eltName, 1, 0);
+    }
+    else if (0 == strcmp("between", eltName)) {
+      w->withBetween = 1;
+      w->lo = whereNum (exp, eltName, 2, 0);
+      w->hi = whereNum (exp, eltName, 2, 1);
+      if (! (w->lo <= w->hi))
+        error ("Input list element 'where$between' must be c(lo,hi) with lo <= hi");
+    }
+    else if (0 == strcmp("finite_only", eltName)) {
+      if ((LGLSXP != TYPEOF(exp)) || (length(exp) != 1) ||
+          (NA_LOGICAL == LOGICAL(exp)[0]))
+        error ("Input list element 'where$finite_only' must be TRUE or FALSE");
+      w->finiteOnly = LOGICAL(exp)[0];
+    }
+    else {
+      error ("Input list element 'where' has unknown test '%s':"
+             " valid tests are 'gt', 'abs_gt', 'between' and 'finite_only'",
+             eltName);
+    }
+  }
+  if ((w->withGt && ISNAN(w->gt)) || (w->withAbsGt && ISNAN(w->absGt)))
+    error ("Input list element 'where' has an NA bound");
+} /* checkWhere */
+
+/* wherePasses: return nonzero if the value v passes the tests in w
+ * NA and NaN fail every comparison, as in R
+ */
+static int
+wherePasses (const valPred_t *w, double v)
+{
+  if (w->finiteOnly && ! R_FINITE(v))
+    return 0;
+  if (w->withGt && ! (v > w->gt))
+    return 0;
+  if (w->withAbsGt && ! (fabs(v) > w->absGt))
+    return 0;
+  if (w->withBetween && ! ((v >= w->lo) && (v <= w->hi)))
+    return 0;
+  return 1;
+} /* wherePasses */
+
 /* checkRgdxList: checks the input request list for valid data
  * and updates the read specifier
  */
@@ -36,14 +115,21 @@ checkRgdxList (const SEXP lst, rSpec_t *rSpec, int *protectCnt)
 {
   SEXP lstNames, tmpUel;
   SEXP bufferUel;
+  SEXP aggExp = NULL;           /* from input requestList */
   SEXP compressExp = NULL;      /* from input requestList */
   SEXP dimExp = NULL;           /* from input requestList */
   SEXP fieldExp = NULL;         /* from input requestList */
   SEXP formExp = NULL;          /* from input requestList */
+  SEXP indexExp = NULL;         /* from input requestList */
+  SEXP keepExp = NULL;          /* from input requestList */
+  SEXP layoutExp = NULL;        /* from input requestList */
+  SEXP lazyExp = NULL;          /* from input requestList */
   SEXP nameExp = NULL;          /* from input requestList */
+  SEXP sliceExp = NULL;         /* from input requestList */
   SEXP teExp = NULL;            /* from input requestList */
   SEXP tsExp = NULL;            /* from input requestList */
   SEXP uelsExp = NULL;          /* from input requestList */
+  SEXP whereExp = NULL;         /* from input requestList */
   int i, j;
   int nElements;                /* number of elements in lst */
   const char *tmpName;
@@ -52,7 +138,7 @@ checkRgdxList (const SEXP lst, rSpec_t *rSpec, int *protectCnt)
 
   nElements = length(lst);
   /* check maximum number of elements */
-  if (nElements < 1 || nElements > 8) {
+  if (nElements < 1 || nElements > 15) {
     error("Incorrect number of elements in input list argument.");
   }
 
@@ -60,7 +146,7 @@ checkRgdxList (const SEXP lst, rSpec_t *rSpec, int *protectCnt)
 
   if (lstNames == R_NilValue) {
     Rprintf("Input list must be named\n");
-    Rprintf("Valid names are: 'name', 'dim', 'uels', 'form', 'compress', 'field', 'te', 'ts'.\n");
+    Rprintf("Valid names are: 'name', 'dim', 'uels', 'form', 'compress', 'field', 'te', 'ts', 'slice', 'index', 'lazy', 'where', 'keep', 'agg', 'layout'.\n");
     error("Please try again with named input list.");
   }
 
@@ -69,7 +155,10 @@ checkRgdxList (const SEXP lst, rSpec_t *rSpec, int *protectCnt)
    */
   for (i = 0;  i < nElements;  i++) {
     elmtName = CHAR(STRING_ELT(lstNames, i));
-    if      (strcmp("compress", elmtName) == 0) {
+    if      (strcmp("agg", elmtName) == 0) {
+      aggExp = VECTOR_ELT(lst, i);
+    }
+    else if (strcmp("compress", elmtName) == 0) {
       compressExp = VECTOR_ELT(lst, i);
     }
     else if (strcmp("dim", elmtName) == 0) {
@@ -81,9 +170,24 @@ checkRgdxList (const SEXP lst, rSpec_t *rSpec, int *protectCnt)
     else if (strcmp("form", elmtName) == 0) {
       formExp = VECTOR_ELT(lst, i);
     }
+    else if (strcmp("index", elmtName) == 0) {
+      indexExp = VECTOR_ELT(lst, i);
+    }
+    else if (strcmp("keep", elmtName) == 0) {
+      keepExp = VECTOR_ELT(lst, i);
+    }
+    else if (strcmp("layout", elmtName) == 0) {
+      layoutExp = VECTOR_ELT(lst, i);
+    }
+    else if (strcmp("lazy", elmtName) == 0) {
+      lazyExp = VECTOR_ELT(lst, i);
+    }
     else if (strcmp("name", elmtName) == 0) {
       nameExp = VECTOR_ELT(lst, i);
     }
+    else if (strcmp("slice", elmtName) == 0) {
+      sliceExp = VECTOR_ELT(lst, i);
+    }
     else if (strcmp("te", elmtName) == 0) {
       teExp = VECTOR_ELT(lst, i);
     }
@@ -93,9 +197,12 @@ checkRgdxList (const SEXP lst, rSpec_t *rSpec, int *protectCnt)
     else if (strcmp("uels", elmtName) == 0) {
       uelsExp = VECTOR_ELT(lst, i);
     }
+    else if (strcmp("where", elmtName) == 0) {
+      whereExp = VECTOR_ELT(lst, i);
+    }
     else {
       Rprintf ("Input list elements for rgdx must be according to this specification:\n");
-      Rprintf ("'name', 'dim', 'uels', 'form', 'compress', 'field', 'te', 'ts'.\n");
+      Rprintf ("'name', 'dim', 'uels', 'form', 'compress', 'field', 'te', 'ts', 'slice', 'index', 'lazy', 'where', 'keep', 'agg', 'layout'.\n");
       error("Incorrect type of rgdx input list element '%s' specified.",
             elmtName);
     }
@@ -169,32 +276,56 @@ checkRgdxList (const SEXP lst, rSpec_t *rSpec, int *protectCnt)
                TYPEOF(fieldExp));
       error("Input list element 'field' must be string");
     }
-    tmpName = CHAR(STRING_ELT(fieldExp, 0));
-    if (strlen(tmpName) == 0) {
-      error("Input list element 'field' must be in ['l','m','lo','up','s','all'].");
+    if (length(fieldExp) < 1 || length(fieldExp) > GMS_VAL_MAX) {
+      error(fieldErrorMsg);
     }
     rSpec->withField = 1;
-    if      (0 == strcasecmp("l", tmpName)) {
-      rSpec->dField = level;
-    }
-    else if (0 == strcasecmp("m", tmpName)) {
-      rSpec->dField = marginal;
-    }
-    else if (0 == strcasecmp("lo", tmpName)) {
-      rSpec->dField = lower;
-    }
-    else if (0 == strcasecmp("up", tmpName)) {
-      rSpec->dField = upper;
-    }
-    else if (0 == strcasecmp("s", tmpName)) {
-      rSpec->dField = scale;
-    }
-    else if (0 == strcasecmp("all", tmpName)) {
+    for (j = 0;  j < length(fieldExp);  j++) {
+      dField_t dField;
+
+      tmpName = CHAR(STRING_ELT(fieldExp, j));
+      if (strlen(tmpName) == 0) {
+        error(fieldErrorMsg);
+      }
+      if      (0 == strcasecmp("l", tmpName)) {
+        dField = level;
+      }
+      else if (0 == strcasecmp("m", tmpName)) {
+        dField = marginal;
+      }
+      else if (0 == strcasecmp("lo", tmpName)) {
+        dField = lower;
+      }
+      else if (0 == strcasecmp("up", tmpName)) {
+        dField = upper;
+      }
+      else if (0 == strcasecmp("s", tmpName)) {
+        dField = scale;
+      }
+      else if (0 == strcasecmp("all", tmpName)) {
+        dField = all;
+      }
+      else {
+        error(fieldErrorMsg);
+      }
+      if (1 == length(fieldExp)) {
+        rSpec->dField = dField;
+        if (all == dField)
+          allFields (&rSpec->fields);
+        break;
+      }
+      /* several fields, e.g. c('l','m'): read like 'all', but only these */
+      if (all == dField)
+        error("Input list element 'field' must be 'all' or a vector of"
+              " distinct fields in ['l','m','lo','up','s'].");
+      for (i = 0;  i < j;  i++) {
+        if (rSpec->fields.idx[i] == (int) dField)
+          error("Input list element 'field' has field '%s' twice", tmpName);
+      }
+      rSpec->fields.idx[j] = dField;
+      rSpec->fields.n = j+1;
       rSpec->dField = all;
     }
-    else {
-      error("Input list element 'field' must be in ['l','m','lo','up','s','all'].");
-     }
   } /* if fieldExp */
 
   if (formExp && (R_NilValue != formExp)) {
@@ -210,11 +341,111 @@ checkRgdxList (const SEXP lst, rSpec_t *rSpec, int *protectCnt)
     else if (strcasecmp("sparse", tmpName) == 0) {
       rSpec->dForm = sparse;
     }
+    else if (strcasecmp("Matrix", tmpName) == 0) {
+      rSpec->dForm = sparse;    /* read sparse, then convert */
+      rSpec->asMatrix = 1;
+    }
     else {
-      error("Input list element 'form' must be either 'full' or 'sparse'.");
+      error("Input list element 'form' must be 'full', 'sparse' or 'Matrix'.");
     }
   } /* formExp */
 
+  if (layoutExp && (R_NilValue != layoutExp)) {
+    if ((STRSXP != TYPEOF(layoutExp)) || (1 != length(layoutExp))) {
+      error ("Input list element 'layout' must be a string");
+    }
+    tmpName = CHAR(STRING_ELT(layoutExp, 0));
+    if (strcasecmp("wide", tmpName) == 0) {
+      rSpec->wide = 1;
+    }
+    else if (strcasecmp("long", tmpName) == 0) {
+      rSpec->wide = 0;
+    }
+    else {
+      error("Input list element 'layout' must be either 'long' or 'wide'.");
+    }
+  } /* layoutExp */
+
+  if (whereExp && (R_NilValue != whereExp)) {
+    checkWhere (whereExp, &rSpec->where);
+    rSpec->withWhere = 1;
+  } /* whereExp */
+
+  if (aggExp && (R_NilValue != aggExp)) {
+    if ((STRSXP != TYPEOF(aggExp)) || (1 != length(aggExp))) {
+      error ("Input list element 'agg' must be a string");
+    }
+    tmpName = CHAR(STRING_ELT(aggExp, 0));
+    if (strcasecmp("sum", tmpName) == 0)
+      rSpec->agg = aggSum;
+    else if (strcasecmp("min", tmpName) == 0)
+      rSpec->agg = aggMin;
+    else if (strcasecmp("max", tmpName) == 0)
+      rSpec->agg = aggMax;
+    else if (strcasecmp("mean", tmpName) == 0)
+      rSpec->agg = aggMean;
+    else if (strcasecmp("count", tmpName) == 0)
+      rSpec->agg = aggCount;
+    else {
+      error("Input list element 'agg' must be 'sum', 'min', 'max', 'mean' or 'count'.");
+    }
+  } /* aggExp */
+
+  if (keepExp) {
+    double d;
+
+    if (aggNone == rSpec->agg)
+      error ("Input list element 'keep' requires 'agg'");
+    if ((R_NilValue != keepExp) &&
+        (REALSXP != TYPEOF(keepExp)) && (INTSXP != TYPEOF(keepExp)))
+      error ("Input list element 'keep' must be a vector of index positions");
+    if (length(keepExp) > GMS_MAX_INDEX_DIM)
+      error ("Input list element 'keep' has too many index positions");
+    rSpec->nKeep = length(keepExp);
+    for (j = 0;  j < rSpec->nKeep;  j++) {
+      d = (REALSXP == TYPEOF(keepExp)) ? REAL(keepExp)[j] :
+        ((NA_INTEGER == INTEGER(keepExp)[j]) ? NA_REAL : INTEGER(keepExp)[j]);
+      if (ISNAN(d) || (d < 1) || (d > GMS_MAX_INDEX_DIM) || (d != (int) d))
+        error ("Input list element 'keep' must hold index positions 1, 2, ...");
+      rSpec->keep[j] = (int) d;
+      for (i = 0;  i < j;  i++) {
+        if (rSpec->keep[i] == rSpec->keep[j])
+          error ("Input list element 'keep' has index position %d twice",
+                 rSpec->keep[j]);
+      }
+    }
+  } /* keepExp */
+  else if (aggNone != rSpec->agg) {
+    error ("Input list element 'agg' requires 'keep'");
+  }
+
+  if (indexExp && (R_NilValue != indexExp)) {
+    if (STRSXP != TYPEOF(indexExp)) {
+      Rprintf ("List element 'index' must be a string - found %d instead\n",
+               TYPEOF(indexExp));
+      error ("Input list element 'index' must be string");
+    }
+    tmpName = CHAR(STRING_ELT(indexExp, 0));
+    if (strcasecmp("integer", tmpName) == 0) {
+      rSpec->intIndex = 1;
+    }
+    else if (strcasecmp("double", tmpName) == 0) {
+      rSpec->intIndex = 0;
+    }
+    else {
+      error("Input list element 'index' must be either 'integer' or 'double'.");
+    }
+  } /* indexExp */
+
+  if (lazyExp && (R_NilValue != lazyExp)) {
+    if (LGLSXP != TYPEOF(lazyExp)) {
+      error("Input list element 'lazy' must be logical");
+    }
+    if (LOGICAL(lazyExp)[0] == TRUE) {
+      rSpec->lazy = 1;
+    }
+  } /* lazyExp */
+
   if (NULL == nameExp)
     error ("Required list element 'name' is missing. Please try again." );
   if (TYPEOF(nameExp) != STRSXP) {
@@ -226,6 +457,25 @@ checkRgdxList (const SEXP lst, rSpec_t *rSpec, int *protectCnt)
   checkStringLength (tmpName);
   strcpy (rSpec->name, tmpName);
 
+  if (sliceExp && (R_NilValue != sliceExp)) {
+    if (TYPEOF(sliceExp) != VECSXP) {
+      error("List element 'slice' must be a list.");
+    }
+    for (j = 0;  j < length(sliceExp);  j++) {
+      tmpUel = VECTOR_ELT(sliceExp, j);
+      if (R_NilValue == tmpUel)
+        continue;               /* free index position */
+      if ((STRSXP != TYPEOF(tmpUel)) || (1 != length(tmpUel)) ||
+          ('\0' == *CHAR(STRING_ELT(tmpUel, 0)))) {
+        error("Elements of list element 'slice' must be a single UEL string,"
+              " or NULL for a free index position.");
+      }
+      checkStringLength (CHAR(STRING_ELT(tmpUel, 0)));
+    }
+    rSpec->slice = sliceExp;
+    rSpec->withSlice = 1;
+  } /* sliceExp */
+
   if (teExp && (R_NilValue != teExp)) {
     if (TYPEOF(teExp) == STRSXP ) {
       tmpName = CHAR(STRING_ELT(teExp, 0));
@@ -337,654 +587,1865 @@ SEXP aliasReturn (const char *symName, const char *aliasFor)
   return outList;
 } /* aliasReturn */
 
-/* rgdx: gateway function for reading gdx, called from R via .External
- * first argument <- gdx file name
- * second argument <- requestList containing several elements
- * that make up a read specifier, e.g. symbol name, dim, form, etc
- * third argument <- squeeze specifier
- * fourth argument <- useDomInfo specifier
- * fifth argument <- followAlias specifier
- * ------------------------------------------------------------------ */
-SEXP rgdx (SEXP args)
+/* universeMatches: return TRUE if the cached universe agrees with the
+ * UELs in the open GDX file at the first, middle and last positions
+ * Cheap, and enough to catch a file rewritten in place with the same
+ * id, e.g. by wgdx within the same second.
+ */
+static Rboolean
+universeMatches (SEXP universe, int nUEL)
 {
-  const char *funcName = "rgdx";
-  SEXP fileName, requestList, squeezeExp, udi, followAliasExp, universe;
-  SEXP targs;
-  Rboolean inventSetText = NA_LOGICAL;
-#if 0
-  Rboolean domainNames = FALSE; /* dataframe names() <--> domain info in GDX */
-#endif
-  SEXP outName = R_NilValue,
-    outType = R_NilValue,
-    outDim = R_NilValue,
-    outValSp = R_NilValue,      /* output .val, sparse form */
-    outValFull = R_NilValue,    /* output .val, full form */
-    outForm = R_NilValue,
-    outUels = R_NilValue,
-    outField = R_NilValue,
-    outTs = R_NilValue,
-    outTeSp = R_NilValue,       /* output .te, sparse form */
-    outTeFull = R_NilValue,     /* output .te, full form */
-    outDomains = R_NilValue,    /* output $domains */
-    outDomInfo = R_NilValue;    /* output $domInfo */
-  int domInfoCode;
-  int reuseFilter = 0;          /* reuse input filter for outUels */
-  SEXP outListNames, outList, dimVect, dimNames;
-  SEXP tmpExp;
-  hpFilter_t hpFilter[GMS_MAX_INDEX_DIM];
-  xpFilter_t xpFilter[GMS_MAX_INDEX_DIM];
-  int outIdx[GMS_MAX_INDEX_DIM];
-  FILE    *fin;
-  rSpec_t *rSpec;
-  gdxUelIndex_t uels;
-  gdxValues_t values;
-  gdxSVals_t sVals;
-  d64_t d64;
-  double dt, posInf, negInf;
-  shortStringBuf_t msgBuf;
   shortStringBuf_t uelName;
-  shortStringBuf_t gdxFileName;
-  int symIdx, symDim, symType, symNNZ, symUser = 0, typeCode = 0;
-  int symDimX;                  /* allow for additional dim on var/equ with field='all' */
-  SEXP fieldUels = R_NilValue; /* UELS for addition dimension for field */
-  int iDim;
-  int rc, findrc, errNum, nUEL, iUEL;
-  int mrows = 0;                /* NNZ count, i.e. number of rows in
-                                 * $val when form='sparse' */
-  int nCols;                    /* number of cols in $val when form='sparse' */
-  int kk, iRec, nRecs, index, changeIdx, kRec;
-  int rgdxAlloc;                /* PROTECT count: undo this many on exit */
-  int UELUserMapping, highestMappedUEL;
-  int foundTuple;
-  int arglen, matched = -1;
-  double *p, *dimVal;
-  char buf[2*sizeof(shortStringBuf_t)+1024];  /* 1024 for rSpec_t::name */
-  char symName[GMS_SSSIZE];
-  char symText[GMS_SSSIZE], msg[GMS_SSSIZE], stringEle[GMS_SSSIZE];
-  char domInfoSrc[16] = "unknown";
-  char *types[] = {"set", "parameter", "variable", "equation"};
-  char *forms[] = {"full", "sparse"};
-  char *fields[] = {"l", "m", "lo", "up", "s", "all"};
-  int elementIndex, IDum, totalElement;
-  int withList = 0;
-  int outElements = 0;    /* count of elements in outList */
-  int iElement;           /* index into outList, outListNames */
-  int nnz;         /* symbol cardinality, i.e. nonzero count */
-  int nnzMax;      /* maximum possible nnz for this symbol */
-  Rboolean squeezeDef = NA_LOGICAL; /* squeeze out default records */
-  Rboolean useDomInfo = NA_LOGICAL;
-  Rboolean followAlias = NA_LOGICAL;
-
-  /* setting initial values */
-  rgdxAlloc = 0;
+  int pos[3], k, UELUserMapping;
+
+  if (length(universe) != nUEL)
+    return FALSE;
+  pos[0] = 1;
+  pos[1] = (nUEL + 1) / 2;
+  pos[2] = nUEL;
+  for (k = 0;  k < 3 && pos[k] <= nUEL;  k++) {
+    if (!gdxUMUelGet (gdxHandle, pos[k], uelName, &UELUserMapping)) {
+      error("Could not gdxUMUelGet");
+    }
+    if (strcmp (uelName, CHAR(STRING_ELT(universe, pos[k]-1))))
+      return FALSE;
+  }
+  return TRUE;
+} /* universeMatches */
+
+/* getUniverse: return the UEL universe of the GDX file open in gdxHandle,
+ * i.e. a string vector with UEL k in position k-1.
+ * The universe is built on first use and kept in the file cache,
+ * so repeated reads from the same open file share it.  It is also kept
+ * in the package-level UEL cache, so reads of the same file version
+ * in later calls can skip building it.
+ */
+SEXP
+getUniverse (SEXP fileCache)
+{
+  SEXP universe;
+  shortStringBuf_t uelName;
+  int nUEL, iUEL, UELUserMapping, highestMappedUEL;
 
-  /* first arg is function name - ignore it */
-  arglen = length(args);
+  universe = VECTOR_ELT(fileCache, FCACHE_UNIVERSE);
+  if (R_NilValue != universe)
+    return universe;
 
-  /* ----------------- Check proper number of inputs and outputs ------------
-   * Function should follow specification of
-   * rgdx ('gdxFileName', requestList = NULL, squeeze = TRUE, useDomInfo=TRUE,
-   *       followAlias=TRUE)
-   * ------------------------------------------------------------------------ */
-  if (6 != arglen) {
-    error ("usage: %s(gdxName, requestList = NULL, squeeze = TRUE,"
-           " useDomInfo = TRUE, followAlias = TRUE) - incorrect arg count",
-           funcName);
-  }
-  targs = CDR(args);
-  fileName       = CAR(targs);  targs = CDR(targs);
-  requestList    = CAR(targs);  targs = CDR(targs);
-  squeezeExp     = CAR(targs);  targs = CDR(targs);
-  udi            = CAR(targs);  targs = CDR(targs);
-  followAliasExp = CAR(targs);  targs = CDR(targs);
-  if (TYPEOF(fileName) != STRSXP) {
-    error ("usage: %s(gdxName, requestList = NULL) - gdxName must be a string", funcName);
+  (void) gdxUMUelInfo (gdxHandle, &nUEL, &highestMappedUEL);
+  universe = uelCacheGet (VECTOR_ELT(fileCache, FCACHE_FILEID));
+  if ((R_NilValue != universe) && universeMatches (universe, nUEL)) {
+    SET_VECTOR_ELT(fileCache, FCACHE_UNIVERSE, universe);
+    return universe;
   }
-  if (TYPEOF(requestList) == NILSXP)
-    withList = 0;
-  else {
-    withList = 1;
-    if (TYPEOF(requestList) != VECSXP) {
-      error ("usage: %s(gdxName, requestList, squeeze, useDomInfo) - requestList must be a list", funcName);
+  PROTECT(universe = allocVector(STRSXP, nUEL));
+  for (iUEL = 1;  iUEL <= nUEL;  iUEL++) {
+    if (!gdxUMUelGet (gdxHandle, iUEL, uelName, &UELUserMapping)) {
+      error("Could not gdxUMUelGet");
     }
+    SET_STRING_ELT(universe, iUEL-1, mkChar(uelName));
   }
+  /* shared with later reads, so must not be modified in place */
+  MARK_NOT_MUTABLE(universe);
+  SET_VECTOR_ELT(fileCache, FCACHE_UNIVERSE, universe);
+  uelCachePut (VECTOR_ELT(fileCache, FCACHE_FILEID), universe);
+  UNPROTECT(1);
+  return universe;
+} /* getUniverse */
 
-  (void) CHAR2ShortStr (CHAR(STRING_ELT(fileName, 0)), gdxFileName);
+/* universeReturn: construct and return an expression representing
+ * the UEL universe, as returned by rgdx when no requestList is given
+ * The result is not protected
+ */
+static SEXP
+universeReturn (SEXP universe)
+{
+  SEXP outListNames, outList, outName, outType, outDim;
 
-  if (! withList) {
-    if (0 == strcmp("?", gdxFileName)) {
-      Rprintf ("For version information, try packageVersion('gdxrrw')\n");
-      return R_NilValue;
-    } /* if audit run */
-  } /* if one arg, of character type */
+  PROTECT(outList = allocVector(VECSXP, 6));
+  PROTECT(outListNames = allocVector(STRSXP, 6));
 
-  squeezeDef = exp2Boolean (squeezeExp);
-  if (NA_LOGICAL == squeezeDef) {
-    error ("usage: %s(gdxName, requestList, squeeze = TRUE, useDomInfo = TRUE)\n    squeeze argument could not be interpreted as logical", funcName);
-  }
-  useDomInfo = exp2Boolean (udi);
-  if (NA_LOGICAL == useDomInfo) {
-    error ("usage: %s(gdxName, requestList, squeeze = TRUE, useDomInfo = TRUE)\n    useDomInfo argument could not be interpreted as logical", funcName);
-  }
-  followAlias = exp2Boolean (followAliasExp);
-  if (NA_LOGICAL == followAlias) {
-    error ("usage: %s(gdxName, requestList, squeeze = TRUE, useDomInfo = TRUE, followAlias = TRUE)\n    followAlias argument could not be interpreted as logical", funcName);
-  }
+  SET_STRING_ELT(outListNames, 0, mkChar("name"));
+  PROTECT(outName = allocVector(STRSXP, 1));
+  SET_STRING_ELT(outName, 0, mkChar("*"));
+  SET_VECTOR_ELT(outList     , 0, outName);
+  UNPROTECT(1);
 
-  /* ------------------- check if the GDX file exists --------------- */
-  checkFileExtension (gdxFileName);
-  fin = fopen (gdxFileName, "r");
-  if (fin==NULL) {
-    error ("GDX file '%s' not found", gdxFileName);
-  }
-  fclose(fin);
-  /*-------------------- Checking data for input list ------------*/
-  /* Setting default values */
-  rSpec = malloc(sizeof(*rSpec));
-  memset (rSpec, 0, sizeof(*rSpec));
-  rSpec->dForm = sparse;
-  rSpec->dField = level;
-  rSpec->dim = -1;              /* negative indicates NA */
+  SET_STRING_ELT(outListNames, 1, mkChar("type"));
+  PROTECT(outType = allocVector(STRSXP, 1));
+  SET_STRING_ELT(outType, 0, mkChar("set"));
+  SET_VECTOR_ELT(outList     , 1, outType);
+  UNPROTECT(1);
 
-  memset (hpFilter, 0, sizeof(hpFilter));
-  memset (xpFilter, 0, sizeof(xpFilter));
+  SET_STRING_ELT(outListNames, 2, mkChar("dim"));
+  PROTECT(outDim = allocVector(INTSXP, 1));
+  INTEGER(outDim)[0] = 1;
+  SET_VECTOR_ELT(outList     , 2, outDim);
+  UNPROTECT(1);
 
-  if (withList) {
-    checkRgdxList (requestList, rSpec, &rgdxAlloc);
-    if (rSpec->compress && rSpec->withUel) {
-      error("Compression is not allowed with input UELs");
-    }
-  }
-
-  loadGDX();
-  rc = gdxCreate (&gdxHandle, msgBuf, sizeof(msgBuf));
-  if (0 == rc)
-    error ("Error creating GDX object: %s", msgBuf);
-  rc = gdxOpenRead (gdxHandle, gdxFileName, &errNum);
-  if (errNum || 0 == rc) {
-    error("Could not open gdx file with gdxOpenRead");
-  }
-
-  gdxGetSpecialValues (gdxHandle, sVals);
-  d64.u64 = 0x7fffffffffffffff; /* positive QNaN, mantissa all on */
-  sVals[GMS_SVIDX_UNDEF] = d64.x;
-  sVals[GMS_SVIDX_NA] = NA_REAL;
-  dt = 0.0;
-  posInf =  1 / dt;
-  negInf = -1 / dt;
-  sVals[GMS_SVIDX_EPS] = 0;
-  sVals[GMS_SVIDX_PINF] = posInf;
-  sVals[GMS_SVIDX_MINF] = negInf;
-  gdxSetSpecialValues (gdxHandle, sVals);
-
-  /* read symbol name only if input list is present */
-  if (withList) {
-    /* start searching for symbol */
-    rc = gdxFindSymbol (gdxHandle, rSpec->name, &symIdx);
-    if (! rc) {
-      sprintf (buf, "GDX file %s contains no symbol named '%s'",
-               gdxFileName,
-               rSpec->name );
-      error ("search log for 'contains no symbol named' to find actual error message");
-    }
-    gdxSymbolInfo (gdxHandle, symIdx, symName, &symDim, &symType);
-    gdxSymbolInfoX (gdxHandle, symIdx, &symNNZ, &symUser, symText);
-    /* symNNZ aka nRecs: count of nonzeros/records in symbol */
+  /* entering null values if nothing else makes sense */
+  SET_STRING_ELT(outListNames, 3, mkChar("val"));
+  SET_VECTOR_ELT(outList     , 3, R_NilValue);
+  SET_STRING_ELT(outListNames, 4, mkChar("form"));
+  SET_VECTOR_ELT(outList     , 4, R_NilValue);
+  SET_STRING_ELT(outListNames, 5, mkChar("uels"));
+  SET_VECTOR_ELT(outList     , 5, universe);
 
-    switch (symType) {
-    case GMS_DT_SET:
-      if (rSpec->withField)
-        error("Bad read specifier for set symbol '%s': 'field' not allowed.",
-              rSpec->name);
-      break;
-    case GMS_DT_PAR:
-      if (rSpec->withField)
-        error("Bad read specifier for parameter symbol '%s': 'field' not allowed.",
-              rSpec->name);
-      break;
-    case GMS_DT_VAR:
-      if (rSpec->compress) {
-        error("Compression is not allowed when reading variables");
-      }
-      typeCode = gmsFixVarType (symUser);
-      if (typeCode < 0) {
-        error ("Variable symbol '%s' has no associated type (e.g. free, binary)",
-               rSpec->name);
-      }
-      break;
-    case GMS_DT_EQU:
-      if (rSpec->compress) {
-        error("Compression is not allowed when reading equations");
-      }
-      typeCode = gmsFixEquType (symUser);
-      if (typeCode < 0) {
-        error ("Equation symbol '%s' has no associated type (e.g. =E=, =G=)",
-               rSpec->name);
-      }
-      break;
-    case GMS_DT_ALIAS:          /* follow link to actual set */
-      if (followAlias) {
-        symIdx = symUser;
-        gdxSymbolInfo (gdxHandle, symIdx, symName, &symDim, &symType);
-        gdxSymbolInfoX (gdxHandle, symIdx, &symNNZ, &symUser, symText);
-      }
-      else {
-        char aliasFor[GMS_SSSIZE];
-
-        gdxSymbolInfo (gdxHandle, symUser, aliasFor, &symDim, &symType);
-        outList = aliasReturn (symName, aliasFor);
-        free(rSpec);
-        errNum = gdxClose (gdxHandle);
-        if (errNum != 0) {
-          error("Errors detected when closing gdx file");
-        }
-        (void) gdxFree (&gdxHandle);
-        UNPROTECT(rgdxAlloc+1); /* 1 from aliasReturn call */
-        return outList;
-      }
-      break;
-    default:
-      sprintf(buf, "GDX symbol %s (index=%d, symDim=%d, symType=%d)"
-              " is not recognized as set, parameter, variable, or equation",
-              rSpec->name, symIdx, symDim, symType);
-      error("search log for 'not recognized as set' to find actual error message");
-    } /* end switch */
-
-    if (rSpec->te && symType != GMS_DT_SET) {
-      error("Text elements only exist for sets and symbol '%s' is not a set.",
-            rSpec->name);
-    }
-    if (rSpec->dim >= 0) {
-      /* check that symbol dim agrees with expected dim */
-      if (rSpec->dim != symDim) {
-        sprintf(buf, "Symbol %s has dimension %d but you specifed dim=%d",
-                rSpec->name, symDim, rSpec->dim);
-        error("search log for 'but you specifed dim' to find actual error message");
-      }
-    }
-  } /* if (withList) */
+  setAttrib(outList, R_NamesSymbol, outListNames);
+  UNPROTECT(2);
+  return outList;
+} /* universeReturn */
 
-  /* Get UEL universe from GDX file */
-  (void) gdxUMUelInfo (gdxHandle, &nUEL, &highestMappedUEL);
-  PROTECT(universe = allocVector(STRSXP, nUEL));
-  rgdxAlloc++;
-  for (iUEL = 1;  iUEL <= nUEL;  iUEL++) {
-    if (!gdxUMUelGet (gdxHandle, iUEL, uelName, &UELUserMapping)) {
-      error("Could not gdxUMUelGet");
+/* startFilteredRead: register the uel filters in hpFilter with GDX and
+ * start a filtered read of symbol symIdx, so GDX never returns records
+ * outside the filters.  The filter uels are mapped to user space with
+ * user numbers equal to their internal numbers, so gdxDataReadMap
+ * returns the same indices as gdxDataReadRaw.
+ */
+static void
+startFilteredRead (int symIdx, int symDim, const hpFilter_t hpFilter[],
+                   int *nRecs)
+{
+  int filterAction[GMS_MAX_INDEX_DIM];
+  shortStringBuf_t uelName;
+  int iDim, k, uel;
+
+  if (! gdxUELRegisterMapStart (gdxHandle))
+    error ("Could not gdxUELRegisterMapStart");
+  for (iDim = 0;  iDim < symDim;  iDim++) {
+    for (k = 0;  k < hpFilter[iDim].n;  k++) {
+      uel = hpFilter[iDim].idx[k];
+      if (uel <= 0)
+        continue;               /* not in GDX */
+      if (! gdxUELRegisterMap (gdxHandle, uel,
+                               uelString (R_NilValue, uel, uelName)))
+        error ("Could not gdxUELRegisterMap");
     }
-    SET_STRING_ELT(universe, iUEL-1, mkChar(uelName));
   }
-
-  /* check relevant options */
-  if (rSpec->te) {              /* if we read set text */
-    SEXP o = GetOption1(install("gdx.inventSetText"));
-    if (R_NilValue != o) {
-      if (LGLSXP == TYPEOF(o)) {
-        inventSetText = LOGICAL(o)[0];
-      }
-      else if (asLogical(o))
-        inventSetText = TRUE;
-      else
-        inventSetText = FALSE;
+  if (! gdxUELRegisterDone (gdxHandle))
+    error ("Could not gdxUELRegisterDone");
+
+  for (iDim = 0;  iDim < symDim;  iDim++) {
+    if (! gdxFilterRegisterStart (gdxHandle, iDim+1))
+      error ("Could not gdxFilterRegisterStart");
+    for (k = 0;  k < hpFilter[iDim].n;  k++) {
+      uel = hpFilter[iDim].idx[k];
+      if ((uel > 0) && ! gdxFilterRegister (gdxHandle, uel))
+        error ("Could not gdxFilterRegister");
     }
+    if (! gdxFilterRegisterDone (gdxHandle))
+      error ("Could not gdxFilterRegisterDone");
+    filterAction[iDim] = iDim+1;
   }
+  if (! gdxDataReadFilteredStart (gdxHandle, symIdx, filterAction, nRecs))
+    error ("Could not gdxDataReadFilteredStart");
+} /* startFilteredRead */
+
+/* spVal_t: the sparse $val being filled by a read, with mrows rows:
+ * the double matrix p, or with index='integer' the int index columns
+ * and double value columns of the list returned, filled directly
+ * so no double copy of the index columns is ever made
+ */
+typedef struct spVal {
+  double *p;                    /* mrows x nCols matrix, NULL for int cols */
+  int *idx[GMS_MAX_INDEX_DIM+1]; /* index cols, incl. a 'field' col */
+  double *val[GMS_VAL_MAX];     /* value cols: one, or one per field if wide */
+  int nIdx;                     /* number of index cols */
+  R_xlen_t mrows;
+} spVal_t;
+
+/* spSetIdx: store v in row iRow of index col kCol of sp */
+static void
+spSetIdx (spVal_t *sp, R_xlen_t iRow, int kCol, int v)
+{
+  if (sp->p)
+    sp->p[iRow + kCol * sp->mrows] = v;
+  else
+    sp->idx[kCol][iRow] = v;
+} /* spSetIdx */
 
-#if 0
-  {
-    /* assume domainNames is set to the right default */
-    SEXP o = GetOption1(install("gdx.domainNames"));
+/* spSetVal: store v in row iRow of value col kVal of sp */
+static void
+spSetVal (spVal_t *sp, R_xlen_t iRow, int kVal, double v)
+{
+  if (sp->p)
+    sp->p[iRow + (sp->nIdx + kVal) * sp->mrows] = v;
+  else
+    sp->val[kVal][iRow] = v;
+} /* spSetVal */
+
+/* mkSpVal: allocate the sparse $val with mrows rows and nCols cols,
+ * nIdx of them index cols, and set up sp to fill it
+ * intCols: make the list of int index vectors and double value vectors
+ * returned with index='integer', o/w the usual double matrix
+ * return the new $val, unprotected
+ */
+static SEXP
+mkSpVal (Rboolean intCols, int mrows, int nCols, int nIdx, spVal_t *sp)
+{
+  SEXP spVal, col;
+  int kCol;
+
+  memset (sp, 0, sizeof(*sp));
+  sp->nIdx = nIdx;
+  sp->mrows = mrows;
+  if (! intCols) {
+    spVal = allocMatrix(REALSXP, mrows, nCols);
+    sp->p = REAL(spVal);
+    return spVal;
+  }
+  PROTECT(spVal = allocVector(VECSXP, nCols));
+  for (kCol = 0;  kCol < nCols;  kCol++) {
+    if (kCol < nIdx) {
+      col = allocVector(INTSXP, mrows);
+      sp->idx[kCol] = INTEGER(col);
+    }
+    else {
+      col = allocVector(REALSXP, mrows);
+      sp->val[kCol-nIdx] = REAL(col);
+    }
+    SET_VECTOR_ELT(spVal, kCol, col);
+  }
+  UNPROTECT(1);
+  return spVal;
+} /* mkSpVal */
+
+/* trimSpVal: return the sparse $val spVal, filled via sp, cut down to
+ * its first kRec rows, unprotected.  The int and double cols are cut
+ * one at a time, so only one col is ever copied at once.
+ */
+static SEXP
+trimSpVal (SEXP spVal, const spVal_t *sp, int kRec, int nCols)
+{
+  SEXP newVal, col;
+  int kk;
+
+  if (sp->p) {
+    PROTECT(newVal = allocMatrix(REALSXP, kRec, nCols));
+    for (kk = 0;  kk < nCols;  kk++) {
+      MEMCPY (REAL(newVal) + (R_xlen_t)kk*kRec, sp->p + kk*sp->mrows,
+              sizeof(*sp->p)*kRec);
+    }
+    UNPROTECT(1);
+    return newVal;
+  }
+  for (kk = 0;  kk < nCols;  kk++) {
+    col = VECTOR_ELT(spVal, kk);
+    PROTECT(newVal = allocVector(TYPEOF(col), kRec));
+    if (INTSXP == TYPEOF(col))
+      MEMCPY (INTEGER(newVal), INTEGER(col), sizeof(int)*kRec);
+    else
+      MEMCPY (REAL(newVal), REAL(col), sizeof(double)*kRec);
+    SET_VECTOR_ELT(spVal, kk, newVal);
+    UNPROTECT(1);
+  }
+  return spVal;
+} /* trimSpVal */
+
+/* state for fastStore: the gdxDataReadRawFast callback
+ * gets no user pointer, so this has to be static */
+static struct {
+  int symDim;
+  int nVals;                    /* values per record: 0, 1, or fields->n */
+  int valField;                 /* field to store if nVals == 1 */
+  const fieldSet_t *fields;     /* fields to store if nVals > 1 */
+  Rboolean wide;                /* one row per record, see storeFields */
+  int squeeze;                  /* skip records with valField == defVal */
+  double defVal;
+  const valPred_t *where;       /* value test on valField, NULL for none */
+  xpFilter_t *xpFilter;
+  spVal_t *sp;                  /* sparse $val to fill */
+  int kRec;                     /* rows filled so far */
+  int findrc;                   /* nonzero if findInXPFilter failed */
+} fastState;
+
+/* storeFields: store a record with several fields in the sparse $val sp,
+ * starting at row kRec: one row per field, holding
+ * the symDim index positions outIdx, the field number and its value
+ * With wide (layout='wide'), the record is the single row kRec,
+ * holding outIdx and then the value of each field.
+ * return the number of rows stored
+ */
+static int
+storeFields (spVal_t *sp, int kRec, int symDim, const int outIdx[],
+             const fieldSet_t *fields, Rboolean wide, const double vals[])
+{
+  int kk, f;
+
+  if (wide) {
+    for (kk = 0;  kk < symDim;  kk++)
+      spSetIdx (sp, kRec, kk, outIdx[kk]);
+    for (f = 0;  f < fields->n;  f++)
+      spSetVal (sp, kRec, f, vals[fields->idx[f]]);
+    return 1;
+  }
+  for (f = 0;  f < fields->n;  f++) {
+    for (kk = 0;  kk < symDim;  kk++)
+      spSetIdx (sp, kRec + f, kk, outIdx[kk]);
+    spSetIdx (sp, kRec + f, symDim, 1 + f);
+    spSetVal (sp, kRec + f, 0, vals[fields->idx[f]]);
+  }
+  return fields->n;
+} /* storeFields */
+
+/* fastStore: gdxDataReadRawFast callback storing one record in
+ * fastState.sp, in the same way as the gdxDataReadRaw loops in readSymbol
+ * Errors cannot be raised from here, so they are recorded in fastState.
+ */
+static void GDX_CALLCONV
+fastStore (const int indx[], const double vals[])
+{
+  int outIdx[GMS_MAX_INDEX_DIM];
+  int kk;
+
+  if (fastState.findrc)
+    return;                     /* already failed: ignore the rest */
+  fastState.findrc = findInXPFilter (fastState.symDim, indx,
+                                     fastState.xpFilter, outIdx);
+  if (fastState.findrc)
+    return;
+  if (fastState.squeeze && (fastState.defVal == vals[fastState.valField]))
+    return;
+  if (fastState.where && ! wherePasses (fastState.where, vals[fastState.valField]))
+    return;
+  if (fastState.nVals > 1) {
+    fastState.kRec += storeFields (fastState.sp, fastState.kRec,
+                                   fastState.symDim, outIdx, fastState.fields,
+                                   fastState.wide, vals);
+    return;
+  }
+  for (kk = 0;  kk < fastState.symDim;  kk++)
+    spSetIdx (fastState.sp, fastState.kRec, kk, outIdx[kk]);
+  if (fastState.nVals)
+    spSetVal (fastState.sp, fastState.kRec, 0, vals[fastState.valField]);
+  fastState.kRec++;
+} /* fastStore */
+
+/* fastRead: read symbol symIdx without a user uel filter into
+ * the sparse $val sp via gdxDataReadRawFast
+ * wide: with dField == all, store one row per record (layout='wide')
+ * where: value test, NULL for none
+ * return the number of rows of sp filled
+ */
+static int
+fastRead (int symIdx, int symDim, int symType, int typeCode, dField_t dField,
+          const fieldSet_t *fields, Rboolean wide, Rboolean squeezeDef,
+          xpFilter_t xpFilter[],
+          const valPred_t *where, spVal_t *sp)
+{
+  int nRecs;
+
+  memset (&fastState, 0, sizeof(fastState));
+  fastState.symDim = symDim;
+  fastState.where = where;
+  fastState.xpFilter = xpFilter;
+  fastState.sp = sp;
+  switch (symType) {
+  case GMS_DT_SET:
+    fastState.nVals = 0;        /* no squeeze for a set */
+    break;
+  case GMS_DT_PAR:
+    fastState.nVals = 1;
+    fastState.valField = GMS_VAL_LEVEL;
+    fastState.squeeze = squeezeDef;
+    break;
+  case GMS_DT_VAR:
+  case GMS_DT_EQU:
+    if (all == dField) {
+      fastState.nVals = fields->n;
+      fastState.fields = fields;
+      fastState.wide = wide;
+      fastState.valField = fields->idx[0];
+    }
+    else {
+      fastState.nVals = 1;
+      fastState.valField = dField;
+      fastState.squeeze = squeezeDef;
+      fastState.defVal = getDefVal (symType, typeCode, dField);
+    }
+    break;
+  default:
+    error("Unrecognized type of symbol found.");
+  }
+  /* gdxDataReadRawFast does its own gdxDataReadDone */
+  if (! gdxDataReadRawFast (gdxHandle, symIdx, fastStore, &nRecs))
+    error ("Could not gdxDataReadRawFast");
+  if (fastState.findrc)
+    error ("DEBUG 00: findrc = %d is unhandled", fastState.findrc);
+  return fastState.kRec;
+} /* fastRead */
+
+/* dropListElt: return a copy of the named list lst
+ * without the element named eltName, unprotected
+ */
+static SEXP
+dropListElt (SEXP lst, const char *eltName)
+{
+  SEXP lstNames, newLst, newNames;
+  int i, k, n;
+
+  lstNames = getAttrib(lst, R_NamesSymbol);
+  n = length(lst);
+  for (k = 0, i = 0;  i < n;  i++) {
+    if (strcmp(eltName, CHAR(STRING_ELT(lstNames, i))))
+      k++;
+  }
+  PROTECT(newLst = allocVector(VECSXP, k));
+  PROTECT(newNames = allocVector(STRSXP, k));
+  for (k = 0, i = 0;  i < n;  i++) {
+    if (0 == strcmp(eltName, CHAR(STRING_ELT(lstNames, i))))
+      continue;
+    SET_VECTOR_ELT(newLst, k, VECTOR_ELT(lst, i));
+    SET_STRING_ELT(newNames, k, STRING_ELT(lstNames, i));
+    k++;
+  }
+  setAttrib(newLst, R_NamesSymbol, newNames);
+  UNPROTECT(2);
+  return newLst;
+} /* dropListElt */
+
+/* sparseToIntIndex: return the nRec x nCols sparse $val spVal as a list
+ * of symDim integer index vectors, followed by the double vector of
+ * values unless the symbol is a set (nCols == symDim)
+ */
+static SEXP
+sparseToIntIndex (SEXP spVal, int symDim, int nRec, int nCols)
+{
+  SEXP intVal, col;
+  const double *p;
+  int *idx;
+  int kCol, k;
+
+  p = REAL(spVal);
+  PROTECT(intVal = allocVector(VECSXP, nCols));
+  for (kCol = 0;  kCol < symDim;  kCol++) {
+    col = allocVector(INTSXP, nRec);
+    SET_VECTOR_ELT(intVal, kCol, col);
+    idx = INTEGER(col);
+    for (k = 0;  k < nRec;  k++)
+      idx[k] = (int) p[k];
+    p += nRec;
+  }
+  for (kCol = symDim;  kCol < nCols;  kCol++) {
+    /* the value, or one per field with layout='wide' */
+    col = allocVector(REALSXP, nRec);
+    SET_VECTOR_ELT(intVal, kCol, col);
+    MEMCPY (REAL(col), p, sizeof(*p) * nRec);
+    p += nRec;
+  }
+  UNPROTECT(1);
+  return intVal;
+} /* sparseToIntIndex */
+
+/* haveMatrixPkg: return nonzero if the Matrix package can be loaded */
+static int
+haveMatrixPkg (void)
+{
+  SEXP call;
+  int rc;
+
+  PROTECT(call = lang3(install("requireNamespace"), mkString("Matrix"),
+                       ScalarLogical(TRUE)));
+  SET_TAG(CDDR(call), install("quietly"));
+  rc = (TRUE == asLogical(eval(call, R_BaseEnv)));
+  UNPROTECT(1);
+  return rc;
+} /* haveMatrixPkg */
+
+/* sparseToCSC: return the nRec x nCols sparse $val spVal of a 2-dim
+ * symbol as a compressed sparse column matrix with rows uels[[1]] and
+ * columns uels[[2]]: a Matrix::dgCMatrix if the Matrix package is
+ * available, o/w a list with elements i, p, x, Dim and Dimnames
+ * set values are 1, as in form='full'
+ */
+static SEXP
+sparseToCSC (SEXP spVal, int nRec, int nCols, SEXP uels, SEXP domains)
+{
+  SEXP csc, iExp, pExp, xExp, dimExp, dimNames, names;
+  const double *pRow, *pCol, *pVal;
+  double *x, *xTmp;
+  int *ii, *colPtr, *next, *perm;
+  int nRow, nCol, j, k, dest, len;
+
+  nRow = length(VECTOR_ELT(uels, 0));
+  nCol = length(VECTOR_ELT(uels, 1));
+  pRow = REAL(spVal);
+  pCol = pRow + nRec;
+  pVal = (nCols > 2) ? pCol + nRec : NULL;
+
+  PROTECT(iExp = allocVector(INTSXP, nRec));
+  PROTECT(pExp = allocVector(INTSXP, nCol+1));
+  PROTECT(xExp = allocVector(REALSXP, nRec));
+  ii = INTEGER(iExp);
+  colPtr = INTEGER(pExp);
+  x = REAL(xExp);
+
+  /* count the records in each column, then place them by column */
+  (void) memset (colPtr, 0, (nCol+1) * sizeof(*colPtr));
+  for (k = 0;  k < nRec;  k++)
+    colPtr[(int) pCol[k]]++;
+  for (j = 0;  j < nCol;  j++)
+    colPtr[j+1] += colPtr[j];
+  next = (int *) R_alloc (nCol + 1, sizeof(*next));
+  MEMCPY (next, colPtr, (nCol+1) * sizeof(*next));
+  for (k = 0;  k < nRec;  k++) {
+    dest = next[(int) pCol[k] - 1]++;
+    ii[dest] = (int) pRow[k] - 1;
+    x[dest] = pVal ? pVal[k] : 1;
+  }
+
+  /* GDX order is by UEL index: with a domain filter, the rows in a
+   * column need not be in filter order, so sort them where needed */
+  perm = NULL;
+  xTmp = NULL;
+  for (j = 0;  j < nCol;  j++) {
+    len = colPtr[j+1] - colPtr[j];
+    for (k = colPtr[j] + 1;  k < colPtr[j+1];  k++) {
+      if (ii[k] < ii[k-1])
+        break;
+    }
+    if (k >= colPtr[j+1])
+      continue;                 /* already sorted */
+    if (NULL == perm) {
+      perm = (int *) R_alloc (nRow, sizeof(*perm));
+      xTmp = (double *) R_alloc (nRow, sizeof(*xTmp));
+    }
+    for (k = 0;  k < len;  k++) {
+      perm[k] = k;
+      xTmp[k] = x[colPtr[j] + k];
+    }
+    R_qsort_int_I (ii + colPtr[j], perm, 1, len);
+    for (k = 0;  k < len;  k++)
+      x[colPtr[j] + k] = xTmp[perm[k]];
+  }
+
+  PROTECT(dimExp = allocVector(INTSXP, 2));
+  INTEGER(dimExp)[0] = nRow;
+  INTEGER(dimExp)[1] = nCol;
+  PROTECT(dimNames = allocVector(VECSXP, 2));
+  SET_VECTOR_ELT(dimNames, 0, VECTOR_ELT(uels, 0));
+  SET_VECTOR_ELT(dimNames, 1, VECTOR_ELT(uels, 1));
+  if (R_NilValue != domains) {
+    PROTECT(names = allocVector(STRSXP, 2));
+    SET_STRING_ELT(names, 0, STRING_ELT(domains, 0));
+    SET_STRING_ELT(names, 1, STRING_ELT(domains, 1));
+    setAttrib(dimNames, R_NamesSymbol, names);
+    UNPROTECT(1);
+  }
+
+  if (haveMatrixPkg()) {
+    PROTECT(csc = R_do_new_object (R_do_MAKE_CLASS ("dgCMatrix")));
+    R_do_slot_assign (csc, install("i"), iExp);
+    R_do_slot_assign (csc, install("p"), pExp);
+    R_do_slot_assign (csc, install("x"), xExp);
+    R_do_slot_assign (csc, install("Dim"), dimExp);
+    R_do_slot_assign (csc, install("Dimnames"), dimNames);
+  }
+  else {
+    PROTECT(csc = allocVector(VECSXP, 5));
+    SET_VECTOR_ELT(csc, 0, iExp);
+    SET_VECTOR_ELT(csc, 1, pExp);
+    SET_VECTOR_ELT(csc, 2, xExp);
+    SET_VECTOR_ELT(csc, 3, dimExp);
+    SET_VECTOR_ELT(csc, 4, dimNames);
+    PROTECT(names = allocVector(STRSXP, 5));
+    SET_STRING_ELT(names, 0, mkChar("i"));
+    SET_STRING_ELT(names, 1, mkChar("p"));
+    SET_STRING_ELT(names, 2, mkChar("x"));
+    SET_STRING_ELT(names, 3, mkChar("Dim"));
+    SET_STRING_ELT(names, 4, mkChar("Dimnames"));
+    setAttrib(csc, R_NamesSymbol, names);
+    UNPROTECT(1);
+  }
+  UNPROTECT(6);
+  return csc;
+} /* sparseToCSC */
+
+/* state for sliceStore: the gdxDataReadSlice callback
+ * gets no user pointer, so this has to be static */
+static struct {
+  int symDim;                   /* free index positions in the slice */
+  int nVals;                    /* values per record: 1 or fields->n */
+  int valField;                 /* field to store if nVals == 1 */
+  const fieldSet_t *fields;     /* fields to store if nVals > 1 */
+  int squeeze;                  /* skip records with valField == defVal */
+  double defVal;
+  const valPred_t *where;       /* value test on valField, NULL for none */
+  double *buf;                  /* records kept, recLen doubles each */
+  int recLen;
+  int bufRecs;                  /* capacity of buf, in records */
+  int nnz;                      /* records in buf */
+  int noMem;                    /* nonzero if buf could not grow */
+} sliceState;
+
+/* sliceStore: gdxDataReadSlice callback buffering one record of the slice
+ * The keys passed in are zero-based positions in the slice UELs
+ * of the free index positions.
+ */
+static void GDX_CALLCONV
+sliceStore (const int indx[], const double vals[])
+{
+  double *rec;
+  int kk;
+
+  if (sliceState.noMem)
+    return;
+  if (sliceState.squeeze && (sliceState.defVal == vals[sliceState.valField]))
+    return;
+  if (sliceState.where && ! wherePasses (sliceState.where, vals[sliceState.valField]))
+    return;
+  if (sliceState.nnz >= sliceState.bufRecs) {
+    rec = realloc(sliceState.buf,
+                  2 * (size_t)sliceState.bufRecs * sliceState.recLen * sizeof(*rec));
+    if (NULL == rec) {
+      sliceState.noMem = 1;
+      return;
+    }
+    sliceState.buf = rec;
+    sliceState.bufRecs *= 2;
+  }
+  rec = sliceState.buf + (size_t)sliceState.nnz * sliceState.recLen;
+  for (kk = 0;  kk < sliceState.symDim;  kk++)
+    rec[kk] = indx[kk] + 1;
+  if (1 == sliceState.nVals)
+    rec[sliceState.symDim] = vals[sliceState.valField];
+  else {
+    for (kk = 0;  kk < sliceState.nVals;  kk++)
+      rec[sliceState.symDim+kk] = vals[sliceState.fields->idx[kk]];
+  }
+  sliceState.nnz++;
+} /* sliceStore */
+
+/* bufToSparse: copy nnz buffered records of recLen doubles each
+ * (symDim one-based indices followed by nVals values)
+ * to the sparse $val sp with nCols columns
+ * With nVals > 1, the values are those of several fields (e.g. field='all'),
+ * and each becomes a row with the field number in column symDim.
+ * For layout='wide', pass nVals = 1 and nCols = recLen: each record
+ * is one row, with a value column per field.
+ */
+static void
+bufToSparse (const double *buf, int nnz, int recLen, int symDim, int nVals,
+             int nCols, spVal_t *sp)
+{
+  const double *rec;
+  R_xlen_t iRow;                /* row of sp, may be a long vector */
+  int kRec, kk, f;
+
+  if (1 == nVals) {
+    /* nCols is symDim for sets, symDim+1 or recLen (wide) o/w */
+    for (kRec = 0;  kRec < nnz;  kRec++) {
+      rec = buf + (size_t)kRec * recLen;
+      for (kk = 0;  kk < symDim;  kk++)
+        spSetIdx (sp, kRec, kk, (int) rec[kk]);
+      for (kk = symDim;  kk < nCols;  kk++)
+        spSetVal (sp, kRec, kk - symDim, rec[kk]);
+    }
+    return;
+  }
+  for (kRec = 0;  kRec < nnz;  kRec++) {
+    rec = buf + (size_t)kRec * recLen;
+    for (f = 0;  f < nVals;  f++) {
+      iRow = (R_xlen_t)kRec * nVals + f;
+      for (kk = 0;  kk < symDim;  kk++)
+        spSetIdx (sp, iRow, kk, (int) rec[kk]);
+      spSetIdx (sp, iRow, symDim, 1 + f);
+      spSetVal (sp, iRow, 0, rec[symDim+f]);
+    }
+  }
+} /* bufToSparse */
+
+/* teCache_t: CHARSXPs of the set element texts fetched so far in one
+ * read, by text index: many records usually share the same text
+ * The CHARSXPs are not protected here: each is stored in the
+ * protected $te vector right after it is made.
+ */
+typedef struct teCache {
+  SEXP *chars;                  /* chars[k] for text index k, NULL if not yet fetched */
+  int n;                        /* length of chars */
+} teCache_t;
+
+/* teCacheGet: return text number elementIndex as a CHARSXP, fetching
+ * it from GDX and interning it only on first use in this read
+ */
+static SEXP
+teCacheGet (teCache_t *tc, int elementIndex)
+{
+  char msg[GMS_SSSIZE];
+  SEXP *chars;
+  int n, IDum;
+
+  if (elementIndex >= tc->n) {
+    n = (2 * tc->n > elementIndex) ? 2 * tc->n : elementIndex + 1;
+    if (n < 256)
+      n = 256;
+    chars = (SEXP *) R_alloc (n, sizeof(*chars));
+    if (tc->n > 0)
+      MEMCPY (chars, tc->chars, tc->n * sizeof(*chars));
+    (void) memset (chars + tc->n, 0, (n - tc->n) * sizeof(*chars));
+    tc->chars = chars;
+    tc->n = n;
+  }
+  if (NULL == tc->chars[elementIndex]) {
+    gdxGetElemText (gdxHandle, elementIndex, msg, &IDum);
+    tc->chars[elementIndex] = mkChar(msg);
+  }
+  return tc->chars[elementIndex];
+} /* teCacheGet */
+
+/* labelTable_t: for inventing set text, the UEL labels and their
+ * lengths for each index position, by one-based position in the filter
+ */
+typedef struct labelTable {
+  int symDim;                   /* zero if the table is not yet built */
+  const char **str[GMS_MAX_INDEX_DIM];
+  int *len[GMS_MAX_INDEX_DIM];
+} labelTable_t;
+
+/* mkLabels: fill the labels of one index position of lt
+ * uelIdx: UEL index for each of the n filter positions,
+ *   or NULL if position k is UEL k
+ */
+static void
+mkLabels (labelTable_t *lt, int iDim, SEXP universe, int n, const int *uelIdx)
+{
+  const char *s;
+  int k, u;
+
+  lt->str[iDim] = (const char **) R_alloc (n, sizeof(*lt->str[iDim]));
+  lt->len[iDim] = (int *) R_alloc (n, sizeof(*lt->len[iDim]));
+  for (k = 0;  k < n;  k++) {
+    u = uelIdx ? uelIdx[k] : k+1;
+    /* a filter UEL not in the GDX file matches no record */
+    s = (u > 0) ? CHAR(STRING_ELT(universe, u-1)) : "";
+    lt->str[iDim][k] = s;
+    lt->len[iDim][k] = strlen(s);
+  }
+} /* mkLabels */
+
+/* inventText: return the invented set text for the record with
+ * one-based filter positions pos, i.e. its UELs joined by '.'
+ */
+static SEXP
+inventText (const labelTable_t *lt, const int pos[])
+{
+  char buf[GMS_MAX_INDEX_DIM * GMS_SSSIZE];
+  char *to = buf;
+  int iDim, k;
+
+  for (iDim = 0;  iDim < lt->symDim;  iDim++) {
+    k = pos[iDim] - 1;
+    if (iDim > 0)
+      *to++ = '.';
+    MEMCPY (to, lt->str[iDim][k], lt->len[iDim][k]);
+    to += lt->len[iDim][k];
+  }
+  return mkCharLen(buf, (int) (to - buf));
+} /* inventText */
+
+/* readToFull: read symbol symIdx without a user uel filter directly
+ * into the full-form .val pFull, without a sparse .val in between
+ * card: extent of each index position, i.e. the length of its $uels
+ * fields: the fields to read if dField == all
+ * where: value test, NULL for none
+ */
+static void
+readToFull (int symIdx, int symDim, int symType, int typeCode, dField_t dField,
+            const fieldSet_t *fields, Rboolean squeezeDef,
+            xpFilter_t xpFilter[], const int card[],
+            const valPred_t *where, double *pFull)
+{
+  gdxUelIndex_t uels;
+  gdxValues_t values;
+  int outIdx[GMS_MAX_INDEX_DIM];
+  R_xlen_t fullCard, index;     /* 64-bit: pFull may be a long vector */
+  int nRecs, iRec, changeIdx, findrc, k;
+  int valField = GMS_VAL_LEVEL;
+  int squeeze = 0;
+  double defVal = 0;
+
+  for (fullCard = 1, k = 0;  k < symDim;  k++)
+    fullCard *= card[k];
+  initFullVal (pFull, fullCard, symType, typeCode, dField, fields);
+  switch (symType) {
+  case GMS_DT_SET:
+    break;
+  case GMS_DT_PAR:
+    squeeze = squeezeDef;
+    break;
+  case GMS_DT_VAR:
+  case GMS_DT_EQU:
+    if (all != dField) {
+      valField = dField;
+      squeeze = squeezeDef;
+      defVal = getDefVal (symType, typeCode, dField);
+    }
+    else
+      valField = fields->idx[0];
+    break;
+  default:
+    error("Unrecognized type of symbol found.");
+  }
+
+  gdxDataReadRawStart (gdxHandle, symIdx, &nRecs);
+  for (iRec = 0;  iRec < nRecs;  iRec++) {
+    gdxDataReadRaw (gdxHandle, uels, values, &changeIdx);
+    findrc = findInXPFilter (symDim, uels, xpFilter, outIdx);
+    if (findrc) {
+      error ("DEBUG 00: findrc = %d is unhandled", findrc);
+    }
+    /* a squeezed record leaves the default in place, as in sparseToFull */
+    if (squeeze && (defVal == values[valField]))
+      continue;
+    if (where && ! wherePasses (where, values[valField]))
+      continue;
+    for (index = outIdx[symDim-1]-1, k = symDim-2;  k >= 0;  k--)
+      index = (index * card[k]) + outIdx[k] - 1;
+    if (GMS_DT_SET == symType)
+      pFull[index] = 1;
+    else if (all != dField || (GMS_DT_PAR == symType))
+      pFull[index] = values[valField];
+    else {
+      for (k = 0;  k < fields->n;  k++)
+        pFull[index + k*fullCard] = values[fields->idx[k]];
+    }
+  } /* loop over GDX records */
+  if (!gdxDataReadDone (gdxHandle)) {
+    error ("Could not gdxDataReadDone");
+  }
+} /* readToFull */
+
+/* accumulator for an 'agg' read: one group per distinct combination
+ * of the kept index positions */
+typedef struct aggState {
+  aggOp_t op;
+  int nKeep;
+  int isDense;                  /* acc and cnt indexed by the group's offset */
+  R_xlen_t denseLen;            /* groups possible, if isDense */
+  int *keys;                    /* hashed groups: nKeep positions each */
+  double *acc;                  /* sum, min or max so far, by group */
+  int *cnt;                     /* records seen, by group */
+  int nGroups;                  /* hashed groups in use */
+  int maxGroups;                /* capacity of keys, acc and cnt */
+  int *slot;                    /* hash table: 1 + group, 0 if empty */
+  int nSlots;                   /* a power of 2 */
+} aggState_t;
+
+/* aggSlot: return the slot of the hash table for key, which holds
+ * either the group with this key or nothing
+ */
+static int
+aggSlot (const aggState_t *a, const int key[])
+{
+  unsigned int h = 0;
+  int k, g, s;
+
+  for (k = 0;  k < a->nKeep;  k++)
+    h = (h * 31) + (unsigned int) key[k];
+  h ^= h >> 16;
+  for (s = (int) (h & (a->nSlots-1));  ;  s = (s+1) & (a->nSlots-1)) {
+    g = a->slot[s] - 1;
+    if (g < 0)
+      return s;
+    for (k = 0;  k < a->nKeep;  k++) {
+      if (a->keys[(size_t)g*a->nKeep + k] != key[k])
+        break;
+    }
+    if (k == a->nKeep)
+      return s;
+  }
+} /* aggSlot */
+
+/* aggGroup: return the hashed group for key, adding it if needed */
+static int
+aggGroup (aggState_t *a, const int key[])
+{
+  int *oldSlot, *p;
+  double *q;
+  int s, g, k, nOld;
+
+  s = aggSlot (a, key);
+  if (a->slot[s])
+    return a->slot[s] - 1;
+  if (a->nGroups >= a->maxGroups) {
+    nOld = a->maxGroups;
+    a->maxGroups *= 2;
+    p = (int *) R_alloc ((size_t)a->maxGroups * a->nKeep, sizeof(int));
+    MEMCPY (p, a->keys, (size_t)nOld * a->nKeep * sizeof(int));
+    a->keys = p;
+    q = (double *) R_alloc (a->maxGroups, sizeof(double));
+    MEMCPY (q, a->acc, (size_t)nOld * sizeof(double));
+    a->acc = q;
+    p = (int *) R_alloc (a->maxGroups, sizeof(int));
+    MEMCPY (p, a->cnt, (size_t)nOld * sizeof(int));
+    a->cnt = p;
+  }
+  g = a->nGroups++;
+  for (k = 0;  k < a->nKeep;  k++)
+    a->keys[(size_t)g*a->nKeep + k] = key[k];
+  a->cnt[g] = 0;
+  a->slot[s] = g + 1;
+  if (2 * a->nGroups > a->nSlots) {
+    /* rehash into a table twice the size */
+    oldSlot = a->slot;
+    a->nSlots *= 2;
+    a->slot = (int *) R_alloc (a->nSlots, sizeof(int));
+    memset (a->slot, 0, (size_t)a->nSlots * sizeof(int));
+    for (k = 0;  k < a->nSlots / 2;  k++) {
+      if (oldSlot[k])
+        a->slot[aggSlot (a, a->keys + (size_t)(oldSlot[k]-1)*a->nKeep)] = oldSlot[k];
+    }
+  }
+  return g;
+} /* aggGroup */
+
+/* aggAdd: add the value v to group g */
+static void
+aggAdd (aggState_t *a, R_xlen_t g, double v)
+{
+  if (0 == a->cnt[g])
+    a->acc[g] = v;
+  else {
+    switch (a->op) {
+    case aggSum:
+    case aggMean:
+      a->acc[g] += v;
+      break;
+    case aggMin:                /* NA and NaN stick, as in R */
+      if ((v < a->acc[g]) || ISNAN(v))
+        a->acc[g] = v;
+      break;
+    case aggMax:
+      if ((v > a->acc[g]) || ISNAN(v))
+        a->acc[g] = v;
+      break;
+    default:
+      break;
+    }
+  }
+  a->cnt[g]++;
+} /* aggAdd */
+
+/* aggValue: return the aggregate for group g */
+static double
+aggValue (const aggState_t *a, R_xlen_t g)
+{
+  if (aggCount == a->op)
+    return a->cnt[g];
+  if (aggMean == a->op)
+    return a->acc[g] / a->cnt[g];
+  return a->acc[g];
+} /* aggValue */
+
+/* this is very un-thread-safe */
+static const int *qAggKeys = NULL;
+static int qAggN = 0;
+
+/* qsort's comparison for hashed groups: compare their keys */
+static int
+aggSortCmp (const void *p1, const void *p2)
+{
+  const int *k1 = qAggKeys + (size_t)(* (const int *)p1) * qAggN;
+  const int *k2 = qAggKeys + (size_t)(* (const int *)p2) * qAggN;
+  int k;
+
+  for (k = 0;  k < qAggN;  k++) {
+    if (k1[k] > k2[k])
+      return 1;
+    else if (k1[k] < k2[k])
+      return -1;
+  }
+  return 0;
+} /* aggSortCmp */
+
+/* aggRead: read symbol symIdx, combining its records into one group
+ * for each distinct combination of the index positions rSpec->keep
+ * hpFilter: user uel filter, or NULL to use xpFilter
+ * card: extent of each kept index position, i.e. the length of its $uels
+ * return *nnz records of nKeep positions and the aggregate value,
+ *   sorted by position, in memory from R_alloc
+ */
+static double *
+aggRead (int symIdx, int symDim, const rSpec_t *rSpec, int valField,
+         Rboolean squeeze, double defVal, hpFilter_t hpFilter[],
+         xpFilter_t xpFilter[], const int card[], int *nnz)
+{
+  aggState_t a;
+  gdxUelIndex_t uels;
+  gdxValues_t values;
+  int outIdx[GMS_MAX_INDEX_DIM];
+  int key[GMS_MAX_INDEX_DIM];
+  const valPred_t *where = rSpec->withWhere ? &rSpec->where : NULL;
+  double denseLen, *buf, *rec;
+  R_xlen_t g;
+  int nRecs, iRec, changeIdx, findrc, k, nKeep, *order;
+
+  nKeep = rSpec->nKeep;
+  memset (&a, 0, sizeof(a));
+  a.op = rSpec->agg;
+  a.nKeep = nKeep;
+  gdxDataReadRawStart (gdxHandle, symIdx, &nRecs);
+
+  /* a dense accumulator if it is not much bigger than the symbol */
+  for (denseLen = 1, k = 0;  k < nKeep;  k++)
+    denseLen *= card[k];
+  a.isDense = (denseLen <= 4.0 * nRecs + 4096);
+  if (a.isDense) {
+    a.denseLen = (R_xlen_t) denseLen;
+    a.acc = (double *) R_alloc (a.denseLen, sizeof(double));
+    a.cnt = (int *) R_alloc (a.denseLen, sizeof(int));
+    memset (a.cnt, 0, (size_t)a.denseLen * sizeof(int));
+  }
+  else {
+    a.maxGroups = 1024;
+    a.keys = (int *) R_alloc ((size_t)a.maxGroups * nKeep, sizeof(int));
+    a.acc = (double *) R_alloc (a.maxGroups, sizeof(double));
+    a.cnt = (int *) R_alloc (a.maxGroups, sizeof(int));
+    a.nSlots = 2048;
+    a.slot = (int *) R_alloc (a.nSlots, sizeof(int));
+    memset (a.slot, 0, (size_t)a.nSlots * sizeof(int));
+  }
+
+  for (iRec = 0;  iRec < nRecs;  iRec++) {
+    gdxDataReadRaw (gdxHandle, uels, values, &changeIdx);
+    if (squeeze && (defVal == values[valField]))
+      continue;
+    if (where && ! wherePasses (where, values[valField]))
+      continue;
+    if (hpFilter) {
+      if (! findInHPFilter (symDim, uels, hpFilter, outIdx))
+        continue;
+    }
+    else {
+      findrc = findInXPFilter (symDim, uels, xpFilter, outIdx);
+      if (findrc) {
+        error ("DEBUG 00: findrc = %d is unhandled", findrc);
+      }
+    }
+    if (a.isDense) {
+      for (g = 0, k = 0;  k < nKeep;  k++)
+        g = (g * card[k]) + outIdx[rSpec->keep[k]-1] - 1;
+    }
+    else {
+      for (k = 0;  k < nKeep;  k++)
+        key[k] = outIdx[rSpec->keep[k]-1];
+      g = aggGroup (&a, key);
+    }
+    aggAdd (&a, g, values[valField]);
+  } /* loop over GDX records */
+  if (!gdxDataReadDone (gdxHandle)) {
+    error ("Could not gdxDataReadDone");
+  }
+
+  /* one record per group, first kept position slowest */
+  if (a.isDense) {
+    for (*nnz = 0, g = 0;  g < a.denseLen;  g++) {
+      if (a.cnt[g])
+        (*nnz)++;
+    }
+    buf = (double *) R_alloc ((size_t)*nnz * (nKeep+1) + 1, sizeof(double));
+    for (rec = buf, g = 0;  g < a.denseLen;  g++) {
+      R_xlen_t off = g;
+
+      if (0 == a.cnt[g])
+        continue;
+      for (k = nKeep-1;  k >= 0;  k--) {
+        rec[k] = (double) (off % card[k]) + 1;
+        off /= card[k];
+      }
+      rec[nKeep] = aggValue (&a, g);
+      rec += nKeep + 1;
+    }
+  }
+  else {
+    *nnz = a.nGroups;
+    order = (int *) R_alloc (a.nGroups + 1, sizeof(int));
+    for (k = 0;  k < a.nGroups;  k++)
+      order[k] = k;
+    qAggKeys = a.keys;
+    qAggN = nKeep;
+    qsort (order, a.nGroups, sizeof(order[0]), aggSortCmp);
+    buf = (double *) R_alloc ((size_t)*nnz * (nKeep+1) + 1, sizeof(double));
+    for (rec = buf, g = 0;  g < a.nGroups;  g++) {
+      for (k = 0;  k < nKeep;  k++)
+        rec[k] = a.keys[(size_t)order[g]*nKeep + k];
+      rec[nKeep] = aggValue (&a, order[g]);
+      rec += nKeep + 1;
+    }
+  }
+  return buf;
+} /* aggRead */
+
+/* readSymbol: read one symbol from the GDX file open in gdxHandle
+ * gdxFileName: used in messages only
+ * requestList: read specifier, as passed to rgdx
+ * fileCache: per-file cache, shared by all reads from this open file
+ * return the symbol in rgdx list form, unprotected
+ */
+static SEXP
+readSymbol (const char *gdxFileName, SEXP requestList, Rboolean squeezeDef,
+            Rboolean useDomInfo, Rboolean followAlias, SEXP fileCache,
+            SEXP reader)
+{
+  SEXP universe;
+  Rboolean inventSetText = NA_LOGICAL;
+#if 0
+  Rboolean domainNames = FALSE; /* dataframe names() <--> domain info in GDX */
+#endif
+  SEXP outName = R_NilValue,
+    outType = R_NilValue,
+    outDim = R_NilValue,
+    outValSp = R_NilValue,      /* output .val, sparse form */
+    outValFull = R_NilValue,    /* output .val, full form */
+    outForm = R_NilValue,
+    outUels = R_NilValue,
+    outField = R_NilValue,
+    outTs = R_NilValue,
+    outTeSp = R_NilValue,       /* output .te, sparse form */
+    outTeFull = R_NilValue,     /* output .te, full form */
+    outDomains = R_NilValue,    /* output $domains */
+    outDomInfo = R_NilValue,    /* output $domInfo */
+    outLayout = R_NilValue;     /* output $layout, for layout='wide' */
+  int domInfoCode;
+  int reuseFilter = 0;          /* reuse input filter for outUels */
+  SEXP outListNames, outList, dimVect, dimNames;
+  SEXP tmpExp;
+  hpFilter_t hpFilter[GMS_MAX_INDEX_DIM];
+  xpFilter_t xpFilter[GMS_MAX_INDEX_DIM];
+  int outIdx[GMS_MAX_INDEX_DIM];
+  rSpec_t *rSpec;
+  gdxUelIndex_t uels;
+  gdxValues_t values;
+  char buf[2*sizeof(shortStringBuf_t)+1024];  /* 1024 for rSpec_t::name */
+  int symIdx, symDim, symType, symNNZ, symUser = 0, typeCode = 0;
+  int symDimX;                  /* allow for additional dim on var/equ with field='all' */
+  Rboolean wideRows = FALSE;    /* sparse rows are records, a value col per field */
+  SEXP fieldUels = R_NilValue; /* UELS for addition dimension for field */
+  int iDim;
+  int rc, findrc, nUEL, highestMappedUEL;
+  int mrows = 0;                /* NNZ count, i.e. number of rows in
+                                 * $val when form='sparse' */
+  int nCols;                    /* number of cols in $val when form='sparse' */
+  int kk, iRec, nRecs, changeIdx, kRec;
+  R_xlen_t index;               /* offset into $val, may be a long vector */
+  int rgdxAlloc;                /* PROTECT count: undo this many on exit */
+  double *dimVal;
+  char symName[GMS_SSSIZE];
+  char symText[GMS_SSSIZE];
+  char domInfoSrc[16] = "unknown";
+  char *types[] = {"set", "parameter", "variable", "equation"};
+  char *forms[] = {"full", "sparse", "Matrix"};
+  char *fields[] = {"l", "m", "lo", "up", "s", "all"};
+  int elementIndex;
+  R_xlen_t totalElement;  /* length of the full $val */
+  int outElements = 0;    /* count of elements in outList */
+  int iElement;           /* index into outList, outListNames */
+  int nnz;         /* symbol cardinality, i.e. nonzero count */
+  double nnzMaxD;  /* maximum possible nnz for this symbol */
+  int directFull = 0;  /* full .val read directly, without a sparse .val */
+  spVal_t sp;          /* where the read loops store the sparse .val */
+  int nIdx;            /* index cols in the sparse .val, incl. 'field' */
+  Rboolean intCols;    /* fill the index='integer' cols directly */
+  teCache_t teCache;      /* $te strings by text index */
+  labelTable_t labels;    /* UEL labels for invented set text */
+  int sliceDim;    /* symbol dim: symDim counts only the free positions of a slice */
+  int aggDim;      /* symbol dim: symDim counts only the kept positions with 'agg' */
+  const char *sliceStr[GMS_MAX_INDEX_DIM]; /* fixed UELs of a slice, "" if free */
+
+  /* setting initial values */
+  rgdxAlloc = 0;
+  memset (&teCache, 0, sizeof(teCache));
+  memset (&labels, 0, sizeof(labels));
+
+  /*-------------------- Checking data for input list ------------*/
+  /* Setting default values */
+  rSpec = malloc(sizeof(*rSpec));
+  memset (rSpec, 0, sizeof(*rSpec));
+  rSpec->dForm = sparse;
+  rSpec->dField = level;
+  rSpec->dim = -1;              /* negative indicates NA */
+
+  memset (hpFilter, 0, sizeof(hpFilter));
+  memset (xpFilter, 0, sizeof(xpFilter));
+
+  checkRgdxList (requestList, rSpec, &rgdxAlloc);
+  if (rSpec->compress && rSpec->withUel) {
+    error("Compression is not allowed with input UELs");
+  }
+  if (rSpec->withSlice) {
+    if (rSpec->withUel)
+      error("Input UELs are not allowed with 'slice'");
+    if (rSpec->compress)
+      error("Compression is not allowed with 'slice'");
+    if (rSpec->te)
+      error("Text elements are not available with 'slice'");
+  }
+
+  /* start searching for symbol */
+  rc = gdxFindSymbol (gdxHandle, rSpec->name, &symIdx);
+  if (! rc) {
+    sprintf (buf, "GDX file %s contains no symbol named '%s'",
+             gdxFileName,
+             rSpec->name );
+    error ("search log for 'contains no symbol named' to find actual error message");
+  }
+  gdxSymbolInfo (gdxHandle, symIdx, symName, &symDim, &symType);
+  gdxSymbolInfoX (gdxHandle, symIdx, &symNNZ, &symUser, symText);
+  /* symNNZ aka nRecs: count of nonzeros/records in symbol */
+
+  switch (symType) {
+  case GMS_DT_SET:
+    if (rSpec->withField)
+      error("Bad read specifier for set symbol '%s': 'field' not allowed.",
+            rSpec->name);
+    break;
+  case GMS_DT_PAR:
+    if (rSpec->withField)
+      error("Bad read specifier for parameter symbol '%s': 'field' not allowed.",
+            rSpec->name);
+    break;
+  case GMS_DT_VAR:
+    if (rSpec->compress) {
+      error("Compression is not allowed when reading variables");
+    }
+    typeCode = gmsFixVarType (symUser);
+    if (typeCode < 0) {
+      error ("Variable symbol '%s' has no associated type (e.g. free, binary)",
+             rSpec->name);
+    }
+    break;
+  case GMS_DT_EQU:
+    if (rSpec->compress) {
+      error("Compression is not allowed when reading equations");
+    }
+    typeCode = gmsFixEquType (symUser);
+    if (typeCode < 0) {
+      error ("Equation symbol '%s' has no associated type (e.g. =E=, =G=)",
+             rSpec->name);
+    }
+    break;
+  case GMS_DT_ALIAS:            /* follow link to actual set */
+    if (followAlias) {
+      symIdx = symUser;
+      gdxSymbolInfo (gdxHandle, symIdx, symName, &symDim, &symType);
+      gdxSymbolInfoX (gdxHandle, symIdx, &symNNZ, &symUser, symText);
+    }
+    else {
+      char aliasFor[GMS_SSSIZE];
+
+      gdxSymbolInfo (gdxHandle, symUser, aliasFor, &symDim, &symType);
+      outList = aliasReturn (symName, aliasFor);
+      free(rSpec);
+      UNPROTECT(rgdxAlloc+1);   /* 1 from aliasReturn call */
+      return outList;
+    }
+    break;
+  default:
+    sprintf(buf, "GDX symbol %s (index=%d, symDim=%d, symType=%d)"
+            " is not recognized as set, parameter, variable, or equation",
+            rSpec->name, symIdx, symDim, symType);
+    error("search log for 'not recognized as set' to find actual error message");
+  } /* end switch */
+
+  if (rSpec->lazy) {
+    /* $val is read later: it must be exactly the records in the symbol */
+    if (R_NilValue == reader)
+      error("lazy=TRUE requires gdxName to be a gdxReader");
+    if (rSpec->withUel || rSpec->withSlice || rSpec->compress || rSpec->te ||
+        rSpec->intIndex || (full == rSpec->dForm))
+      error("lazy=TRUE is only allowed with form='sparse' and without"
+            " 'uels', 'slice', 'compress', 'te' or 'index'");
+    if (squeezeDef && (GMS_DT_SET != symType) && (all != rSpec->dField))
+      error("lazy=TRUE requires squeeze=FALSE");
+  }
+  if (rSpec->intIndex && ((full == rSpec->dForm) || rSpec->asMatrix)) {
+    error("Input list element 'index' is only allowed with form='sparse'.");
+  }
+  if (rSpec->asMatrix) {
+    if (rSpec->lazy || rSpec->te)
+      error("form='Matrix' is not allowed with 'lazy' or 'te'");
+    if (all == rSpec->dField)
+      error("form='Matrix' is not allowed with field='all' or several fields");
+  }
+  if (rSpec->wide) {
+    if (((GMS_DT_VAR != symType) && (GMS_DT_EQU != symType)) ||
+        (all != rSpec->dField))
+      error("layout='wide' requires a variable or equation read with"
+            " field='all' or several fields");
+  }
+  if (rSpec->withWhere) {
+    if (GMS_DT_SET == symType)
+      error("Input list element 'where' is not allowed for set symbol '%s'",
+            rSpec->name);
+    if (rSpec->lazy)
+      error("Input list element 'where' is not allowed with lazy=TRUE");
+  }
+  if (rSpec->te && symType != GMS_DT_SET) {
+    error("Text elements only exist for sets and symbol '%s' is not a set.",
+          rSpec->name);
+  }
+  if (rSpec->dim >= 0) {
+    /* check that symbol dim agrees with expected dim */
+    if (rSpec->dim != symDim) {
+      sprintf(buf, "Symbol %s has dimension %d but you specifed dim=%d",
+              rSpec->name, symDim, rSpec->dim);
+      error("search log for 'but you specifed dim' to find actual error message");
+    }
+  }
+  /* a slice drops the fixed index positions from the symbol we return */
+  sliceDim = symDim;
+  if (rSpec->withSlice) {
+    if (length(rSpec->slice) != sliceDim) {
+      error("Dimension of slice entered does not match with symbol in GDX");
+    }
+    for (symDim = 0, iDim = 0;  iDim < sliceDim;  iDim++) {
+      tmpExp = VECTOR_ELT(rSpec->slice, iDim);
+      if (R_NilValue == tmpExp) {
+        sliceStr[iDim] = "";
+        symDim++;
+      }
+      else
+        sliceStr[iDim] = CHAR(STRING_ELT(tmpExp, 0));
+    }
+  }
+
+  /* with 'agg', the symbol we return has only the kept index positions */
+  aggDim = symDim;
+  if (aggNone != rSpec->agg) {
+    if (GMS_DT_SET == symType)
+      error("Input list element 'agg' is not allowed for set symbol '%s'",
+            rSpec->name);
+    if (all == rSpec->dField)
+      error("Input list element 'agg' is not allowed with field='all' or several fields");
+    if (rSpec->withSlice || rSpec->compress || rSpec->lazy)
+      error("Input list element 'agg' is not allowed with 'slice',"
+            " 'compress' or 'lazy'");
+    if (rSpec->withUel && length(rSpec->filterUel) != aggDim) {
+      error("Dimension of UEL filter entered does not match with symbol in GDX");
+    }
+    for (kk = 0;  kk < rSpec->nKeep;  kk++) {
+      if (rSpec->keep[kk] > aggDim)
+        error("Input list element 'keep' has index position %d but"
+              " symbol '%s' has dimension %d",
+              rSpec->keep[kk], rSpec->name, aggDim);
+    }
+    symDim = rSpec->nKeep;
+  }
+
+  if (rSpec->asMatrix && (2 != symDim)) {
+    error("form='Matrix' requires a 2-dim symbol: '%s' has dimension %d",
+          rSpec->name, symDim);
+  }
+
+  /* the UEL universe is only built if some dimension needs all of it:
+   * until then, UEL strings are fetched from GDX as they are used */
+  universe = VECTOR_ELT(fileCache, FCACHE_UNIVERSE);
+  (void) gdxUMUelInfo (gdxHandle, &nUEL, &highestMappedUEL);
+
+  /* check relevant options */
+  if (rSpec->te) {              /* if we read set text */
+    SEXP o = GetOption1(install("gdx.inventSetText"));
+    if (R_NilValue != o) {
+      if (LGLSXP == TYPEOF(o)) {
+        inventSetText = LOGICAL(o)[0];
+      }
+      else if (asLogical(o))
+        inventSetText = TRUE;
+      else
+        inventSetText = FALSE;
+    }
+  }
+
+#if 0
+  {
+    /* assume domainNames is set to the right default */
+    SEXP o = GetOption1(install("gdx.domainNames"));
     if (R_NilValue != o) {
       if (LGLSXP == TYPEOF(o)) {
         if (NA_LOGICAL != LOGICAL(o)[0])
           domainNames = LOGICAL(o)[0];
       }
-      else
-        domainNames = asLogical(o);
+      else
+        domainNames = asLogical(o);
+    }
+  }
+#endif
+
+  outElements = 6;   /* outList has at least 6 elements, maybe more */
+  /* Checking dimension of input uel and parameter in GDX file.
+   * If they are not equal then error. */
+  if (rSpec->withUel && (aggNone == rSpec->agg) &&
+      length(rSpec->filterUel) != symDim) {
+    error("Dimension of UEL filter entered does not match with symbol in GDX");
+  }
+  /* initialize hpFilter to use a universe filter for each dimension */
+  for (iDim = 0;  iDim < symDim;  iDim++) {
+    hpFilter[iDim].fType = identity;
+  }
+
+  nCols = symDim + 1;         /* usual index cols + data col */
+  symDimX = symDim;
+  switch (symType) {
+  case GMS_DT_SET:
+    nCols = symDim;           /* no data col */
+    break;
+  case GMS_DT_VAR:
+  case GMS_DT_EQU:
+    if (all == rSpec->dField) {
+      /* layout='wide', and the sparse .val converted to form='full',
+       * have one row per record with a value col per field:
+       * o/w a row per field, with an additional 'field' col */
+      wideRows = rSpec->wide || (full == rSpec->dForm);
+      if (wideRows)
+        nCols += rSpec->fields.n - 1;
+      else
+        nCols++;
+      /* the full .val always has an additional 'field' dim */
+      if (! rSpec->wide || (full == rSpec->dForm))
+        symDimX++;
+      /* the fields read, e.g. l,m,lo,up,s for field='all' */
+      PROTECT(fieldUels = allocVector(STRSXP, rSpec->fields.n));
+      rgdxAlloc++;
+      for (kk = 0;  kk < rSpec->fields.n;  kk++)
+        SET_STRING_ELT(fieldUels, kk, mkChar(fields[rSpec->fields.idx[kk]]));
+    }
+    break;
+  } /* end switch */
+  nIdx = symDim;
+  if ((all == rSpec->dField) && ! wideRows &&
+      ((GMS_DT_VAR == symType) || (GMS_DT_EQU == symType)))
+    nIdx++;                     /* 'field' col */
+  /* compressData works on the double matrix, so it is converted later */
+  intCols = rSpec->intIndex && ! rSpec->compress;
+  memset (&sp, 0, sizeof(sp));
+
+  /* we will have domain info returned for all symbols */
+  PROTECT(outDomains = allocVector(STRSXP, symDimX));
+  rgdxAlloc++;
+  PROTECT(outDomInfo = allocVector(STRSXP, 1));
+  rgdxAlloc++;
+  domInfoCode = 0;
+
+  outTeSp = R_NilValue;
+  nnz = 0;
+  if (aggNone != rSpec->agg) {
+    /* records are combined while they are read: only the groups
+     * of the kept index positions are returned */
+    int card[GMS_MAX_INDEX_DIM];
+    int valField = GMS_VAL_LEVEL;
+    double defVal = 0;
+    double *buf;
+    SEXP allDomains;
+    xpFilter_t keptXp[GMS_MAX_INDEX_DIM];
+
+    PROTECT(allDomains = allocVector(STRSXP, aggDim));
+    if (rSpec->withUel) {
+      for (iDim = 0;  iDim < aggDim;  iDim++) {
+        mkHPFilter (VECTOR_ELT(rSpec->filterUel, iDim), hpFilter + iDim);
+      }
+      prepHPFilter (aggDim, hpFilter);
+      getDomainNames (symIdx, useDomInfo, allDomains, &domInfoCode);
+      for (kk = 0;  kk < symDim;  kk++)
+        card[kk] = hpFilter[rSpec->keep[kk]-1].n;
+    }
+    else {
+      mkXPFilter (symIdx, useDomInfo, xpFilter, allDomains, &domInfoCode,
+                  fileCache);
+      for (kk = 0;  kk < symDim;  kk++) {
+        keptXp[kk] = xpFilter[rSpec->keep[kk]-1];
+        card[kk] = (identity == keptXp[kk].fType) ? nUEL : keptXp[kk].n;
+      }
+    }
+    for (kk = 0;  kk < symDim;  kk++)
+      SET_STRING_ELT(outDomains, kk, STRING_ELT(allDomains, rSpec->keep[kk]-1));
+    UNPROTECT(1);               /* allDomains */
+    (void) strcpy (domInfoSrc, "aggregated");
+
+    if (GMS_DT_PAR != symType) {
+      valField = rSpec->dField;
+      defVal = getDefVal (symType, typeCode, rSpec->dField);
+    }
+    buf = aggRead (symIdx, aggDim, rSpec, valField, squeezeDef, defVal,
+                   rSpec->withUel ? hpFilter : NULL, xpFilter, card, &nnz);
+    mrows = nnz;
+    PROTECT(outValSp = mkSpVal (intCols, mrows, nCols, nIdx, &sp));
+    rgdxAlloc++;
+    bufToSparse (buf, nnz, symDim+1, symDim, 1, nCols, &sp);
+
+    /* $uels for the kept positions */
+    PROTECT(outUels = allocVector(VECSXP, symDim));
+    rgdxAlloc++;
+    if (rSpec->withUel) {
+      for (kk = 0;  kk < symDim;  kk++)
+        SET_VECTOR_ELT(outUels, kk,
+                       VECTOR_ELT(rSpec->filterUel, rSpec->keep[kk]-1));
+      /* from here on, $uels is outUels and not the user filter */
+      rSpec->withUel = 0;
+    }
+    else {
+      for (kk = 0;  kk < symDim;  kk++) {
+        if (identity == keptXp[kk].fType) {
+          universe = getUniverse (fileCache);
+          break;
+        }
+      }
+      xpFilterToUels (symDim, keptXp, universe, outUels);
+    }
+  }   /* if agg */
+  else if (rSpec->withSlice) {
+    /* GDX matches the fixed index positions, so we get only the records
+     * in the slice, keyed by their positions in the slice UELs */
+    int elemCounts[GMS_MAX_INDEX_DIM];
+    int sliceKeys[GMS_MAX_INDEX_DIM];
+    gdxStrIndex_t keyNames;
+    gdxStrIndexPtrs_t keyPtrs;
+    SEXP allDomains, uelList;
+    int uelNr, uelMap, nFree, isEmpty;
+
+    PROTECT(allDomains = allocVector(STRSXP, sliceDim));
+    getDomainNames (symIdx, useDomInfo, allDomains, &domInfoCode);
+    for (kk = 0, iDim = 0;  iDim < sliceDim;  iDim++) {
+      if ('\0' == *sliceStr[iDim])
+        SET_STRING_ELT(outDomains, kk++, STRING_ELT(allDomains, iDim));
+    }
+    UNPROTECT(1);               /* allDomains */
+    (void) strcpy (domInfoSrc, "sliced");
+    if (symDimX > symDim)
+      SET_STRING_ELT(outDomains, symDim, mkChar("_field"));
+
+    memset (&sliceState, 0, sizeof(sliceState));
+    sliceState.symDim = symDim;
+    if (rSpec->withWhere)
+      sliceState.where = &rSpec->where;
+    sliceState.nVals = 1;
+    sliceState.valField = GMS_VAL_LEVEL;
+    switch (symType) {
+    case GMS_DT_SET:            /* no squeeze for a set */
+      break;
+    case GMS_DT_PAR:
+      sliceState.squeeze = squeezeDef;
+      break;
+    case GMS_DT_VAR:
+    case GMS_DT_EQU:
+      if (all == rSpec->dField) {
+        sliceState.nVals = rSpec->fields.n;
+        sliceState.fields = &rSpec->fields;
+        sliceState.valField = rSpec->fields.idx[0];
+      }
+      else {
+        sliceState.valField = rSpec->dField;
+        sliceState.squeeze = squeezeDef;
+        sliceState.defVal = getDefVal (symType, typeCode, rSpec->dField);
+      }
+      break;
+    default:
+      error("Unrecognized type of symbol found.");
+    } /* end switch(symType) */
+    sliceState.recLen = symDim + sliceState.nVals;
+    sliceState.bufRecs = (symNNZ < 1024) ? symNNZ : 1024;
+    if (sliceState.bufRecs < 1)
+      sliceState.bufRecs = 1;
+    sliceState.buf = malloc((size_t)sliceState.bufRecs * sliceState.recLen
+                            * sizeof(*sliceState.buf));
+    if (NULL == sliceState.buf)
+      error ("memory exhaustion error: could not allocate buffer for slice read");
+
+    /* a fixed UEL not in the GDX file gives an empty slice */
+    isEmpty = 0;
+    for (iDim = 0;  iDim < sliceDim;  iDim++) {
+      if (('\0' != *sliceStr[iDim]) &&
+          ! gdxUMFindUEL (gdxHandle, sliceStr[iDim], &uelNr, &uelMap))
+        isEmpty = 1;
+    }
+    if (! gdxDataReadSliceStart (gdxHandle, symIdx, elemCounts)) {
+      free (sliceState.buf);
+      error ("Could not gdxDataReadSliceStart");
+    }
+    if (! isEmpty &&
+        ! gdxDataReadSlice (gdxHandle, sliceStr, &nFree, sliceStore)) {
+      free (sliceState.buf);
+      error ("Could not gdxDataReadSlice");
+    }
+    if (sliceState.noMem) {
+      free (sliceState.buf);
+      error ("memory exhaustion error: could not grow buffer for slice read");
+    }
+
+    /* $uels for the free positions are the slice UELs */
+    PROTECT(outUels = allocVector(VECSXP, symDimX));
+    rgdxAlloc++;
+    GDXSTRINDEXPTRS_INIT (keyNames, keyPtrs);
+    memset (sliceKeys, 0, sizeof(sliceKeys));
+    for (kk = 0, iDim = 0;  iDim < sliceDim;  iDim++) {
+      if ('\0' != *sliceStr[iDim])
+        continue;
+      PROTECT(uelList = allocVector(STRSXP, isEmpty ? 0 : elemCounts[iDim]));
+      for (index = 0;  index < length(uelList);  index++) {
+        sliceKeys[kk] = (int) index;
+        if (! gdxDataSliceUELS (gdxHandle, sliceKeys, keyPtrs)) {
+          free (sliceState.buf);
+          error ("Could not gdxDataSliceUELS");
+        }
+        SET_STRING_ELT(uelList, index, mkChar(keyPtrs[iDim]));
+      }
+      sliceKeys[kk] = 0;
+      SET_VECTOR_ELT(outUels, kk, uelList);
+      UNPROTECT(1);             /* uelList */
+      kk++;
+    }
+    if (symDimX > symDim)
+      SET_VECTOR_ELT(outUels, symDim, fieldUels);
+    if (!gdxDataReadDone (gdxHandle)) {
+      free (sliceState.buf);
+      error ("Could not gdxDataReadDone");
     }
-  }
-#endif
 
-  outElements = 6;   /* outList has at least 6 elements, maybe more */
-  if (withList) { /* aa */
-    /* Checking dimension of input uel and parameter in GDX file.
-     * If they are not equal then error. */
-    if (rSpec->withUel && length(rSpec->filterUel) != symDim) {
-      error("Dimension of UEL filter entered does not match with symbol in GDX");
+    nnz = mrows = sliceState.nnz;
+    if ((sliceState.nVals > 1) && ! wideRows)
+      mrows = sparseAllRows (nnz, sliceState.nVals);
+    PROTECT(outValSp = mkSpVal (intCols, mrows, nCols, nIdx, &sp));
+    rgdxAlloc++;
+    bufToSparse (sliceState.buf, nnz, sliceState.recLen, symDim,
+                 wideRows ? 1 : sliceState.nVals, nCols, &sp);
+    free (sliceState.buf);
+    sliceState.buf = NULL;
+  }   /* if withSlice */
+  else if (rSpec->withUel) {
+    /* Read the records matching the uel filter in one pass, collecting
+     * them in a growable buffer: the number of matches (i.e. the number
+     * of rows in the sparse matrix) is known only at the end, so the
+     * R matrix is allocated and filled afterwards.
+     */
+    double *buf, *rec;
+    double defVal = 0;
+    int nVals;          /* values kept per matching record */
+    int recLen;         /* doubles per buffered record */
+    int bufRecs;        /* capacity of buf, in records */
+    int valField = GMS_VAL_LEVEL;
+    int useFiltered;    /* let GDX do the filtering */
+    const valPred_t *where = rSpec->withWhere ? &rSpec->where : NULL;
+
+    /* create integer filters */
+    for (iDim = 0;  iDim < symDim;  iDim++) {
+      mkHPFilter (VECTOR_ELT(rSpec->filterUel, iDim), hpFilter + iDim);
     }
-    /* initialize hpFilter to use a universe filter for each dimension */
+    for (nnzMaxD = 1, iDim = 0;  iDim < symDim;  iDim++) {
+      nnzMaxD *=  length(VECTOR_ELT(rSpec->filterUel, iDim));
+    }
+
+    (void) strcpy (domInfoSrc, "filtered");
+#if 1
+    getDomainNames (symIdx, useDomInfo, outDomains, &domInfoCode);
+#else
+    /* set domain names to "_user": cannot conflict with real set names */
     for (iDim = 0;  iDim < symDim;  iDim++) {
-      hpFilter[iDim].fType = identity;
+      SET_STRING_ELT(outDomains, iDim, mkChar("_user"));
+    }
+#endif
+    reuseFilter = 1;
+    if (symDimX > symDim) {
+      reuseFilter = 0;
+      SET_STRING_ELT(outDomains, iDim, mkChar("_field"));
     }
 
-    nCols = symDim + 1;         /* usual index cols + data col */
-    symDimX = symDim;
+    nVals = 1;
     switch (symType) {
     case GMS_DT_SET:
-      nCols = symDim;           /* no data col */
+    case GMS_DT_PAR:
       break;
     case GMS_DT_VAR:
     case GMS_DT_EQU:
-      if (all == rSpec->dField) { /* additional 'field' col */
-        nCols++;
-        symDimX++;
-        PROTECT(fieldUels = allocVector(STRSXP, GMS_VAL_MAX));
-        rgdxAlloc++;
-        SET_STRING_ELT(fieldUels, GMS_VAL_LEVEL   , mkChar(fields[GMS_VAL_LEVEL   ]));
-        SET_STRING_ELT(fieldUels, GMS_VAL_MARGINAL, mkChar(fields[GMS_VAL_MARGINAL]));
-        SET_STRING_ELT(fieldUels, GMS_VAL_LOWER   , mkChar(fields[GMS_VAL_LOWER   ]));
-        SET_STRING_ELT(fieldUels, GMS_VAL_UPPER   , mkChar(fields[GMS_VAL_UPPER   ]));
-        SET_STRING_ELT(fieldUels, GMS_VAL_SCALE   , mkChar(fields[GMS_VAL_SCALE   ]));
+      if (all == rSpec->dField) {
+        nVals = rSpec->fields.n; /* e.g. l,m,lo,up,scale */
+        valField = rSpec->fields.idx[0];
       }
-      break;
-    } /* end switch */
-
-    /* we will have domain info returned for all symbols */
-    PROTECT(outDomains = allocVector(STRSXP, symDimX));
-    rgdxAlloc++;
-    PROTECT(outDomInfo = allocVector(STRSXP, 1));
-    rgdxAlloc++;
-    domInfoCode = 0;
-
-    outTeSp = R_NilValue;
-    nnz = 0;
-    if (rSpec->withUel) {
-      /* here we check the cardinality of the symbol we are reading,
-       * i.e. the number of nonzeros, i.e. the number of elements that match
-       * in uel filter.  Given this value,
-       * we can create a 2D double matrix for sparse format.
-       */
-      /* create integer filters */
-      for (iDim = 0;  iDim < symDim;  iDim++) {
-        mkHPFilter (VECTOR_ELT(rSpec->filterUel, iDim), hpFilter + iDim);
+      else {
+        valField = rSpec->dField;
+        defVal = getDefVal (symType, typeCode, rSpec->dField);
       }
-      for (nnzMax = 1, iDim = 0;  iDim < symDim;  iDim++) {
-        nnzMax *=  length(VECTOR_ELT(rSpec->filterUel, iDim));
+      break;
+    default:
+      error("Unrecognized type of symbol found.");
+    } /* end switch(symType) */
+    recLen = symDim + nVals;
+
+    prepHPFilter (symDim, hpFilter);
+    useFiltered = (symDim > 0) && (filteredEngine == getReadEngine());
+    if (useFiltered)
+      startFilteredRead (symIdx, symDim, hpFilter, &nRecs);
+    else
+      gdxDataReadRawStart (gdxHandle, symIdx, &nRecs);
+    bufRecs = (nRecs < 1024) ? nRecs : 1024;
+    if (bufRecs > nnzMaxD)
+      bufRecs = (int) nnzMaxD;
+    if (bufRecs < 1)
+      bufRecs = 1;
+    buf = malloc((size_t)bufRecs * recLen * sizeof(*buf));
+    if (NULL == buf)
+      error ("memory exhaustion error: could not allocate buffer for filtered read");
+    for (nnz = 0, iRec = 0;  (iRec < nRecs) && (nnz < nnzMaxD);  iRec++) {
+      if (! useFiltered)
+        gdxDataReadRaw (gdxHandle, uels, values, &changeIdx);
+      else if (! gdxDataReadMap (gdxHandle, iRec+1, uels, values, &changeIdx))
+        break;                  /* no more records in the filters */
+      /* no squeeze for a set or with field='all' */
+      if (squeezeDef && (GMS_DT_SET != symType) && (1 == nVals) &&
+          (defVal == values[valField]))
+        continue;
+      if (where && ! wherePasses (where, values[valField]))
+        continue;
+      if (! findInHPFilter (symDim, uels, hpFilter, outIdx))
+        continue;
+      if (nnz >= bufRecs) {
+        bufRecs = (bufRecs > nRecs / 2) ? nRecs : 2 * bufRecs;
+        rec = realloc(buf, (size_t)bufRecs * recLen * sizeof(*buf));
+        if (NULL == rec) {
+          free (buf);
+          error ("memory exhaustion error: could not grow buffer for filtered read");
+        }
+        buf = rec;
       }
-
-      (void) strcpy (domInfoSrc, "filtered");
-#if 1
-      getDomainNames (symIdx, useDomInfo, outDomains, &domInfoCode);
-#else
-      /* set domain names to "_user": cannot conflict with real set names */
+      rec = buf + (size_t)nnz * recLen;
       for (iDim = 0;  iDim < symDim;  iDim++) {
-        SET_STRING_ELT(outDomains, iDim, mkChar("_user"));
+        rec[iDim] = outIdx[iDim];
       }
-#endif
-      reuseFilter = 1;
-      if (symDimX > symDim) {
-        reuseFilter = 0;
-        SET_STRING_ELT(outDomains, iDim, mkChar("_field"));
+      if (1 == nVals)
+        rec[symDim] = values[valField];
+      else {
+        for (kk = 0;  kk < nVals;  kk++)
+          rec[symDim+kk] = values[rSpec->fields.idx[kk]];
       }
+      nnz++;
+    } /* loop over GDX records */
+    if (!gdxDataReadDone (gdxHandle)) {
+      free (buf);
+      error ("Could not gdxDataReadDone");
+    }
 
-      /* count records that match the filter and won't be squeezed out */
-      prepHPFilter (symDim, hpFilter);
-      gdxDataReadRawStart (gdxHandle, symIdx, &nRecs);
-      switch (symType) {
-      case GMS_DT_SET:
-        for (nnz = 0, iRec = 0;  iRec < nRecs;  iRec++) {
-          gdxDataReadRaw (gdxHandle, uels, values, &changeIdx);
-          /* no squeeze for a set */
-          foundTuple = findInHPFilter (symDim, uels, hpFilter, outIdx);
-          if (foundTuple) {
-            nnz++;
-            if (nnz >= nnzMax) {
-              break;
-            }
-          }
-        } /* loop over gdx records */
-        break;
-      case GMS_DT_PAR:
-        for (nnz = 0, iRec = 0;  iRec < nRecs;  iRec++) {
-          gdxDataReadRaw (gdxHandle, uels, values, &changeIdx);
-          if (squeezeDef && (0 == values[GMS_VAL_LEVEL]))
-            continue;
-          foundTuple = findInHPFilter (symDim, uels, hpFilter, outIdx);
-          if (foundTuple) {
-            nnz++;
-            if (nnz >= nnzMax) {
-              break;
-            }
-          }
-        } /* loop over gdx records */
-        break;
-      case GMS_DT_VAR:
-      case GMS_DT_EQU:
-        if (all != rSpec->dField) {
-          double defVal = getDefVal (symType, typeCode, rSpec->dField);
-
-          for (nnz = 0, iRec = 0;  iRec < nRecs;  iRec++) {
-            gdxDataReadRaw (gdxHandle, uels, values, &changeIdx);
-            if (squeezeDef && (defVal == values[rSpec->dField]))
-              continue;
-            foundTuple = findInHPFilter (symDim, uels, hpFilter, outIdx);
-            if (foundTuple) {
-              nnz++;
-              if (nnz >= nnzMax) {
-                break;
-              }
-            }
-          } /* loop over GDX records */
-        }
-        else {                /* all == rSpec->dField */
-          for (kRec = 0, iRec = 0;  iRec < nRecs;  iRec++) {
-            gdxDataReadRaw (gdxHandle, uels, values, &changeIdx);
-            /* for now assume no filtering when field==all */
-            foundTuple = findInHPFilter (symDim, uels, hpFilter, outIdx);
-            if (foundTuple) {
-              nnz++;
-              if (nnz >= nnzMax) {
-                break;
-              }
-            }
-          } /* loop over GDX records */
-        }   /* if (all != field) .. else ..  */
-        break;
-      default:
-        error("Unrecognized type of symbol found.");
-      } /* end switch(symType) */
-      if (!gdxDataReadDone (gdxHandle)) {
-        error ("Could not gdxDataReadDone");
-      }
+    mrows = nnz;
+    if ((nVals > 1) && ! wideRows)
+      mrows = sparseAllRows (nnz, nVals);
 
-      mrows = nnz;
-      if ((symType == GMS_DT_VAR || symType == GMS_DT_EQU))
-        if (all == rSpec->dField)
-          mrows *= 5;           /* l,m,lo,up,scale */
+    /* Allocating memory for 2D sparse matrix */
+    PROTECT(outValSp = mkSpVal (intCols, mrows, nCols, nIdx, &sp));
+    rgdxAlloc++;
+    bufToSparse (buf, nnz, recLen, symDim, wideRows ? 1 : nVals, nCols, &sp);
 
-      /* Allocating memory for 2D sparse matrix */
-      PROTECT(outValSp = allocMatrix(REALSXP, mrows, nCols));
+    if (rSpec->te) { /* set element text: the level holds the text index */
+      PROTECT(outTeSp = allocVector(STRSXP, nnz));
       rgdxAlloc++;
-      p = REAL(outValSp);
-
-      if (rSpec->te) { /* read set elements with their text, using filter */
-        PROTECT(outTeSp = allocVector(STRSXP, nnz));
-        rgdxAlloc++;
-        gdxDataReadRawStart (gdxHandle, symIdx, &nRecs);
-        prepHPFilter (symDim, hpFilter);
-        for (matched = 0, iRec = 0;  iRec < nRecs;  iRec++) {
-          gdxDataReadRaw (gdxHandle, uels, values, &changeIdx);
-          foundTuple = findInHPFilter (symDim, uels, hpFilter, outIdx);
-          if (foundTuple) {
-            for (iDim = 0;  iDim < symDim;  iDim++) {
-              p[matched + iDim*nnz] = outIdx[iDim];
-            }
-
-            index = matched + symDim * nnz;
-
-            if (values[GMS_VAL_LEVEL]) {
-              elementIndex = (int) values[GMS_VAL_LEVEL];
-              gdxGetElemText(gdxHandle, elementIndex, msg, &IDum);
-              SET_STRING_ELT(outTeSp, matched, mkChar(msg));
-            }
-            else {
-              if (NA_LOGICAL == inventSetText)
-                SET_STRING_ELT(outTeSp, matched, R_NaString);
-              else if (FALSE == inventSetText) /* make it "" */
-                SET_STRING_ELT(outTeSp, matched, R_BlankString);
-              else { 
-                stringEle[0] = '\0';
-                for (iDim = 0;  iDim < symDim;  iDim++) {
-                  strcat(stringEle, CHAR(STRING_ELT(universe, uels[iDim]-1)));
-                  if (iDim != symDim-1)
-                    strcat(stringEle, ".");
-                }
-                SET_STRING_ELT(outTeSp, matched, mkChar(stringEle));
-              }
-            }
-            matched++;
-          }
-          if (matched == nnz) {
-            break;
-          }
-        }  /* loop over GDX records */
-        if (!gdxDataReadDone (gdxHandle)) {
-          error ("Could not gdxDataReadDone");
+      for (kRec = 0;  kRec < nnz;  kRec++) {
+        rec = buf + (size_t)kRec * recLen;
+        if (rec[symDim]) {
+          elementIndex = (int) rec[symDim];
+          SET_STRING_ELT(outTeSp, kRec, teCacheGet (&teCache, elementIndex));
         }
-      } /* if rSpec->te */
-      else {
-        prepHPFilter (symDim, hpFilter);
-        gdxDataReadRawStart (gdxHandle, symIdx, &nRecs);
-        switch (symType) {
-        case GMS_DT_SET:
-          /* at some point, put the rSpec->te stuff in here instead of above this */
-          if (rSpec->te) {
-            error ("filtered set read: rSpec->te already handled above");
-          }
-          for (matched = 0, iRec = 0;  iRec < nRecs;  iRec++) {
-            gdxDataReadRaw (gdxHandle, uels, values, &changeIdx);
-            /* no squeeze for a set */
-            foundTuple = findInHPFilter (symDim, uels, hpFilter, outIdx);
-            if (foundTuple) {
-              for (iDim = 0;  iDim < symDim;  iDim++) {
-                p[matched + iDim*nnz] = outIdx[iDim];
-              }
-              matched++;
-              if (matched == nnz)
-                break;
-            } /* if foundTuple */
-          } /* loop over GDX records */
-          break;
-        case GMS_DT_PAR:
-          for (matched = 0, iRec = 0;  iRec < nRecs;  iRec++) {
-            gdxDataReadRaw (gdxHandle, uels, values, &changeIdx);
-            if (squeezeDef && (0 == values[GMS_VAL_LEVEL]))
-              continue;
-            foundTuple = findInHPFilter (symDim, uels, hpFilter, outIdx);
-            if (foundTuple) {
-              for (iDim = 0;  iDim < symDim;  iDim++) {
-                p[matched + iDim*nnz] = outIdx[iDim];
-              }
-              index = matched + symDim * nnz;
-              p[index] = values[GMS_VAL_LEVEL];
-              matched++;
-              if (matched == nnz)
-                break;
-            } /* if foundTuple */
-          } /* loop over GDX records */
-          break;
-        case GMS_DT_VAR:
-        case GMS_DT_EQU:
-          if (all != rSpec->dField) {
-            double defVal = getDefVal (symType, typeCode, rSpec->dField);
-
-            for (matched = 0, iRec = 0;  iRec < nRecs;  iRec++) {
-              gdxDataReadRaw (gdxHandle, uels, values, &changeIdx);
-              if (squeezeDef && (defVal == values[rSpec->dField]))
-                continue;
-              foundTuple = findInHPFilter (symDim, uels, hpFilter, outIdx);
-              if (foundTuple) {
-                for (iDim = 0;  iDim < symDim;  iDim++) {
-                  p[matched + iDim*nnz] = outIdx[iDim];
-                }
-                index = matched + symDim * nnz;
-                p[index] = values[rSpec->dField];
-                matched++;
-                if (matched == nnz)
-                  break;
-              } /* if foundTuple */
-            } /* loop over GDX records */
+        else {
+          if (NA_LOGICAL == inventSetText)
+            SET_STRING_ELT(outTeSp, kRec, R_NaString);
+          else if (FALSE == inventSetText) /* make it "" */
+            SET_STRING_ELT(outTeSp, kRec, R_BlankString);
+          else {
+            if (0 == labels.symDim) {
+              universe = getUniverse (fileCache);
+              for (iDim = 0;  iDim < symDim;  iDim++)
+                mkLabels (&labels, iDim, universe, hpFilter[iDim].n,
+                          hpFilter[iDim].idx);
+              labels.symDim = symDim;
+            }
+            /* rec[iDim] is the one-based position in the filter */
+            for (iDim = 0;  iDim < symDim;  iDim++)
+              outIdx[iDim] = (int) rec[iDim];
+            SET_STRING_ELT(outTeSp, kRec, inventText (&labels, outIdx));
           }
-          else {                /* all == rSpec->dField */
-            for (matched = 0, kRec = 0, iRec = 0;  iRec < nRecs;  iRec++) {
-              gdxDataReadRaw (gdxHandle, uels, values, &changeIdx);
-              /* for now assume no filtering when field==all */
-              foundTuple = findInHPFilter (symDim, uels, hpFilter, outIdx);
-              if (foundTuple) {
-                for (index = kRec, kk = 0;  kk < symDim;  kk++) {
-                  p[index+GMS_VAL_LEVEL   ] = outIdx[kk];
-                  p[index+GMS_VAL_MARGINAL] = outIdx[kk];
-                  p[index+GMS_VAL_LOWER   ] = outIdx[kk];
-                  p[index+GMS_VAL_UPPER   ] = outIdx[kk];
-                  p[index+GMS_VAL_SCALE   ] = outIdx[kk];
-                  index += mrows;
-                }
-                p[index+GMS_VAL_LEVEL   ] = 1 + GMS_VAL_LEVEL;
-                p[index+GMS_VAL_MARGINAL] = 1 + GMS_VAL_MARGINAL;
-                p[index+GMS_VAL_LOWER   ] = 1 + GMS_VAL_LOWER;
-                p[index+GMS_VAL_UPPER   ] = 1 + GMS_VAL_UPPER;
-                p[index+GMS_VAL_SCALE   ] = 1 + GMS_VAL_SCALE;
-                index += mrows;
-                p[index+GMS_VAL_LEVEL   ] = values[GMS_VAL_LEVEL];
-                p[index+GMS_VAL_MARGINAL] = values[GMS_VAL_MARGINAL];
-                p[index+GMS_VAL_LOWER   ] = values[GMS_VAL_LOWER];
-                p[index+GMS_VAL_UPPER   ] = values[GMS_VAL_UPPER];
-                p[index+GMS_VAL_SCALE   ] = values[GMS_VAL_SCALE];
-                kRec += GMS_VAL_MAX;
-                matched++;
-                if (matched == nnz)
-                  break;
-              } /* if foundTuple */
-            } /* loop over GDX records */
-          }   /* if (all != field) .. else ..  */
-          break;
-        default:
-          error("Unrecognized type of symbol found.");
-        } /* end switch(symType) */
-        if (!gdxDataReadDone (gdxHandle)) {
-          error ("Could not gdxDataReadDone");
-        }
-        if (matched != nnz)
-          error ("mismatch after filtered read: matched = %d  nnz = %d", matched, nnz);
-      } /* if (te) .. else .. */
-    }   /* if withUel */
-    else {
-      /* read without user UEL filter: use domain info to filter if possible */
-      reuseFilter = 0;
-      mrows = symNNZ;
-      /*  check for non zero elements for variable and equation */
-      if ((symType == GMS_DT_VAR || symType == GMS_DT_EQU)) {
-        if (all == rSpec->dField) {
-          mrows *= 5;           /* l,m,lo,up,scale */
-        }
-        else if (squeezeDef) { /* potentially squeeze some out */
-          mrows = getNonDefaultElemCount(gdxHandle, symIdx, symType, typeCode,
-                                         rSpec->dField);
         }
+      } /* loop over matched records */
+    } /* if rSpec->te */
+    free (buf);
+  }   /* if withUel */
+  else {
+    /* read without user UEL filter: use domain info to filter if possible */
+    const valPred_t *where = rSpec->withWhere ? &rSpec->where : NULL;
+
+    reuseFilter = 0;
+    /* symNNZ bounds the rows we can get: records squeezed out or failing
+     * 'where' are trimmed from outValSp after the read, so one pass suffices */
+    mrows = symNNZ;
+    if ((symType == GMS_DT_VAR || symType == GMS_DT_EQU)) {
+      if ((all == rSpec->dField) && ! wideRows) {
+        mrows = sparseAllRows (symNNZ, rSpec->fields.n); /* e.g. l,m,lo,up,s */
       }
-      /* Create 2D sparse R array */
-      PROTECT(outValSp = allocMatrix(REALSXP, mrows, nCols));
+    }
+    /* with form='full', records go straight into the full .val:
+     * no sparse .val is needed unless we compress or read set text */
+    directFull = (full == rSpec->dForm) && (symDim > 0) &&
+      ! rSpec->compress && ! rSpec->te;
+    /* Create 2D sparse R array */
+    if (directFull) {
+      mrows = 0;
+    }
+    else if (rSpec->lazy) {
+      PROTECT(tmpExp = dropListElt (requestList, "lazy"));
+      rgdxAlloc++;
+      PROTECT(outValSp = mkLazyVal (reader, tmpExp, squeezeDef, useDomInfo,
+                                    (R_xlen_t) mrows * nCols));
       rgdxAlloc++;
-      p = REAL(outValSp);
+      PROTECT(dimVect = allocVector(INTSXP, 2));
+      INTEGER(dimVect)[0] = mrows;
+      INTEGER(dimVect)[1] = nCols;
+      setAttrib(outValSp, R_DimSymbol, dimVect);
+      UNPROTECT(1);
+    }
+    else {
+      PROTECT(outValSp = mkSpVal (intCols, mrows, nCols, nIdx, &sp));
+      rgdxAlloc++;
+    }
 
-      mkXPFilter (symIdx, useDomInfo, xpFilter, outDomains, &domInfoCode);
-      switch (domInfoCode) {
-      case 0:
-        (void) strcpy (domInfoSrc, "NA");
-        break;
-      case 1:
-        (void) strcpy (domInfoSrc, "none");
-        break;
-      case 2:
-        (void) strcpy (domInfoSrc, "relaxed");
-        break;
-      case 3:
-        (void) strcpy (domInfoSrc, "full");
-        break;
+    mkXPFilter (symIdx, useDomInfo, xpFilter, outDomains, &domInfoCode,
+                fileCache);
+    switch (domInfoCode) {
+    case 0:
+      (void) strcpy (domInfoSrc, "NA");
+      break;
+    case 1:
+      (void) strcpy (domInfoSrc, "none");
+      break;
+    case 2:
+      (void) strcpy (domInfoSrc, "relaxed");
+      break;
+    case 3:
+      (void) strcpy (domInfoSrc, "full");
+      break;
+    }
+    if (symDimX > symDim)
+      SET_STRING_ELT(outDomains, iDim, mkChar("_field"));
+
+    kRec = 0;                 /* shut up warnings */
+    if (rSpec->lazy) {
+      kRec = mrows;             /* records are read on first access to $val */
+    }
+    else if (directFull) {
+      int card[GMS_MAX_INDEX_DIM];
+
+      /* the extents are the lengths of the $uels made below */
+      for (totalElement = 1, kk = 0;  kk < symDim;  kk++) {
+        card[kk] = (identity == xpFilter[kk].fType) ? nUEL : xpFilter[kk].n;
+        totalElement *= card[kk];
       }
       if (symDimX > symDim)
-        SET_STRING_ELT(outDomains, iDim, mkChar("_field"));
-
-      kRec = 0;                 /* shut up warnings */
+        totalElement *= rSpec->fields.n;
+      PROTECT(outValFull = allocVector(REALSXP, totalElement));
+      rgdxAlloc++;
+      readToFull (symIdx, symDim, symType, typeCode, rSpec->dField,
+                  &rSpec->fields, squeezeDef, xpFilter, card, where,
+                  REAL(outValFull));
+      kRec = mrows;             /* no sparse .val to trim */
+    }
+    else if ((fastEngine == getReadEngine()) && ! rSpec->te) {
+      kRec = fastRead (symIdx, symDim, symType, typeCode, rSpec->dField,
+                       &rSpec->fields, wideRows, squeezeDef, xpFilter, where,
+                       &sp);
+    }
+    else {
       gdxDataReadRawStart (gdxHandle, symIdx, &nRecs);
       switch (symType) {
       case GMS_DT_SET:
@@ -999,13 +2460,12 @@ SEXP rgdx (SEXP args)
             error ("DEBUG 00: findrc = %d is unhandled", findrc);
           }
           for (kk = 0;  kk < symDim;  kk++) {
-            p[iRec + kk*mrows] = outIdx[kk]; /* from the xpFilter */
+            spSetIdx (&sp, iRec, kk, outIdx[kk]); /* from the xpFilter */
           }
           if (rSpec->te) {
             if (values[GMS_VAL_LEVEL]) {
               elementIndex = (int) values[GMS_VAL_LEVEL];
-              gdxGetElemText(gdxHandle, elementIndex, msg, &IDum);
-              SET_STRING_ELT(outTeSp, iRec, mkChar(msg));
+              SET_STRING_ELT(outTeSp, iRec, teCacheGet (&teCache, elementIndex));
             }
             else {
               if (NA_LOGICAL == inventSetText)
@@ -1013,13 +2473,18 @@ SEXP rgdx (SEXP args)
               else if (FALSE == inventSetText) /* make it "" */
                 SET_STRING_ELT(outTeSp, iRec, R_BlankString);
               else {
-                stringEle[0] = '\0';
-                for (kk = 0;  kk < symDim;  kk++) {
-                  strcat(stringEle, CHAR(STRING_ELT(universe, uels[kk]-1)));
-                  if (kk != symDim-1)
-                    strcat(stringEle, ".");
+                if (0 == labels.symDim) {
+                  universe = getUniverse (fileCache);
+                  for (kk = 0;  kk < symDim;  kk++) {
+                    if (identity == xpFilter[kk].fType)
+                      mkLabels (&labels, kk, universe, nUEL, NULL);
+                    else
+                      mkLabels (&labels, kk, universe, xpFilter[kk].n,
+                                xpFilter[kk].idx);
+                  }
+                  labels.symDim = symDim;
                 }
-                SET_STRING_ELT(outTeSp, iRec, mkChar(stringEle));
+                SET_STRING_ELT(outTeSp, iRec, inventText (&labels, outIdx));
               } /* inventSetText is true */
             }
           } /* if returning set text */
@@ -1033,14 +2498,14 @@ SEXP rgdx (SEXP args)
           if (findrc) {
             error ("DEBUG 00: findrc = %d is unhandled", findrc);
           }
-          if ((! squeezeDef) ||
-              (0 != values[GMS_VAL_LEVEL])) {
+          if (((! squeezeDef) ||
+               (0 != values[GMS_VAL_LEVEL])) &&
+              ((! where) || wherePasses (where, values[GMS_VAL_LEVEL]))) {
             /* store the value */
-            for (index = kRec, kk = 0;  kk < symDim;  kk++) {
-              p[index] = outIdx[kk]; /* from the xpFilter */
-              index += mrows;
+            for (kk = 0;  kk < symDim;  kk++) {
+              spSetIdx (&sp, kRec, kk, outIdx[kk]); /* from the xpFilter */
             }
-            p[index] = values[GMS_VAL_LEVEL];
+            spSetVal (&sp, kRec, 0, values[GMS_VAL_LEVEL]);
             kRec++;
           } /* end if (no squeeze || val != 0) */
         } /* loop over GDX records */
@@ -1061,14 +2526,14 @@ SEXP rgdx (SEXP args)
             if (findrc) {
               error ("DEBUG 00: findrc = %d is unhandled", findrc);
             }
-            if ((! squeezeDef) ||
-                (defVal != values[rSpec->dField])) {
+            if (((! squeezeDef) ||
+                 (defVal != values[rSpec->dField])) &&
+                ((! where) || wherePasses (where, values[rSpec->dField]))) {
               /* store the value */
-              for (index = kRec, kk = 0;  kk < symDim;  kk++) {
-                p[index] = outIdx[kk]; /* from the xpFilter */
-                index += mrows;
+              for (kk = 0;  kk < symDim;  kk++) {
+                spSetIdx (&sp, kRec, kk, outIdx[kk]); /* from the xpFilter */
               }
-              p[index] = values[rSpec->dField];
+              spSetVal (&sp, kRec, 0, values[rSpec->dField]);
               kRec++;
             } /* end if (no squeeze || val != default) */
           } /* loop over GDX records */
@@ -1080,26 +2545,13 @@ SEXP rgdx (SEXP args)
             if (findrc) {
               error ("DEBUG 00: findrc = %d is unhandled", findrc);
             }
-            for (index = kRec, kk = 0;  kk < symDim;  kk++) {
-              p[index+GMS_VAL_LEVEL   ] = outIdx[kk];
-              p[index+GMS_VAL_MARGINAL] = outIdx[kk];
-              p[index+GMS_VAL_LOWER   ] = outIdx[kk];
-              p[index+GMS_VAL_UPPER   ] = outIdx[kk];
-              p[index+GMS_VAL_SCALE   ] = outIdx[kk];
-              index += mrows;
-            }
-            p[index+GMS_VAL_LEVEL   ] = 1 + GMS_VAL_LEVEL;
-            p[index+GMS_VAL_MARGINAL] = 1 + GMS_VAL_MARGINAL;
-            p[index+GMS_VAL_LOWER   ] = 1 + GMS_VAL_LOWER;
-            p[index+GMS_VAL_UPPER   ] = 1 + GMS_VAL_UPPER;
-            p[index+GMS_VAL_SCALE   ] = 1 + GMS_VAL_SCALE;
-            index += mrows;
-            p[index+GMS_VAL_LEVEL   ] = values[GMS_VAL_LEVEL];
-            p[index+GMS_VAL_MARGINAL] = values[GMS_VAL_MARGINAL];
-            p[index+GMS_VAL_LOWER   ] = values[GMS_VAL_LOWER];
-            p[index+GMS_VAL_UPPER   ] = values[GMS_VAL_UPPER];
-            p[index+GMS_VAL_SCALE   ] = values[GMS_VAL_SCALE];
-            kRec += GMS_VAL_MAX;
+            /* with several fields, 'where' tests the first one
+             * and keeps or drops the whole record */
+            if (where &&
+                ! wherePasses (where, values[rSpec->fields.idx[0]]))
+              continue;
+            kRec += storeFields (&sp, kRec, symDim, outIdx,
+                                 &rSpec->fields, wideRows, values);
           } /* loop over GDX records */
         }
         break;
@@ -1109,373 +2561,402 @@ SEXP rgdx (SEXP args)
       if (!gdxDataReadDone (gdxHandle)) {
         error ("Could not gdxDataReadDone");
       }
-      if (kRec < mrows) {
-        SEXP newCV, tmp;
-        double *newp;
-        double *from, *to;
-
-        PROTECT(newCV = allocMatrix(REALSXP, kRec, nCols));
-        newp = REAL(newCV);
-        for (kk = 0;  kk <= symDim;  kk++) {
-          from = p    + kk*mrows;
-          to   = newp + kk*kRec;
-          MEMCPY (to, from, sizeof(*p)*kRec);
-        }
-        tmp = outValSp;
-        outValSp = newCV;
-        UNPROTECT_PTR(tmp);
-        mrows = kRec;
-      }
-    } /* if (withUel .. else .. ) */
+    } /* if fast engine .. else .. */
+    if (kRec < mrows) {
+      SEXP tmp = outValSp;
 
-    /* here the output uels $uels are allocated and populated */
-    if (rSpec->compress) {
-      PROTECT(outUels = allocVector(VECSXP, symDimX));
-      rgdxAlloc++;
-      compressData (symDim, mrows, universe, nUEL, xpFilter,
-                    outValSp, outUels);
-      /* set domain names to "_compressed": cannot conflict with real set names */
+      PROTECT(outValSp = trimSpVal (tmp, &sp, kRec, nCols));
+      UNPROTECT_PTR(tmp);
+      mrows = kRec;
+    }
+  } /* if (withUel .. else .. ) */
+
+  /* here the output uels $uels are allocated and populated */
+  if (rSpec->compress) {
+    PROTECT(outUels = allocVector(VECSXP, symDimX));
+    rgdxAlloc++;
+    compressData (symDim, mrows, universe, nUEL, xpFilter,
+                  outValSp, outUels);
+    /* set domain names to "_compressed": cannot conflict with real set names */
 #if 0
-      for (iDim = 0;  iDim < symDim;  iDim++) {
-        SET_STRING_ELT(outDomains, iDim, mkChar("_compressed"));
-      }
-#endif
-      if (symDimX > symDim) {
-        SET_VECTOR_ELT(outUels, iDim, fieldUels);
-        SET_STRING_ELT(outDomains, iDim, mkChar("_field"));
-      }
-      (void) strcpy (domInfoSrc, "compressed");
+    for (iDim = 0;  iDim < symDim;  iDim++) {
+      SET_STRING_ELT(outDomains, iDim, mkChar("_compressed"));
     }
-    else if (! rSpec->withUel) {
-      PROTECT(outUels = allocVector(VECSXP, symDimX));
-      rgdxAlloc++;
-      xpFilterToUels (symDim, xpFilter, universe, outUels);
-      if (symDimX > symDim)
-        SET_VECTOR_ELT(outUels, iDim, fieldUels);
+#endif
+    if (symDimX > symDim) {
+      SET_VECTOR_ELT(outUels, iDim, fieldUels);
+      SET_STRING_ELT(outDomains, iDim, mkChar("_field"));
     }
-    else if (! reuseFilter) {
-      /* if we got here, we have a UEL filter from the user but must copy it */
-      PROTECT(outUels = allocVector(VECSXP, symDimX));
-      rgdxAlloc++;
-      for (iDim = 0;  iDim < symDim;  iDim++) {
-        SET_VECTOR_ELT(outUels, iDim, VECTOR_ELT(rSpec->filterUel, iDim));
+    (void) strcpy (domInfoSrc, "compressed");
+  }
+  else if (rSpec->withSlice || (aggNone != rSpec->agg)) {
+    /* outUels were made during the slice or aggregated read */
+  }
+  else if (! rSpec->withUel) {
+    PROTECT(outUels = allocVector(VECSXP, symDimX));
+    rgdxAlloc++;
+    for (kk = 0;  kk < symDim;  kk++) {
+      if (identity == xpFilter[kk].fType) {
+        universe = getUniverse (fileCache);
+        break;
       }
+    }
+    xpFilterToUels (symDim, xpFilter, universe, outUels);
+    if (symDimX > symDim)
       SET_VECTOR_ELT(outUels, iDim, fieldUels);
+  }
+  else if (! reuseFilter) {
+    /* if we got here, we have a UEL filter from the user but must copy it */
+    PROTECT(outUels = allocVector(VECSXP, symDimX));
+    rgdxAlloc++;
+    for (iDim = 0;  iDim < symDim;  iDim++) {
+      SET_VECTOR_ELT(outUels, iDim, VECTOR_ELT(rSpec->filterUel, iDim));
     }
+    SET_VECTOR_ELT(outUels, iDim, fieldUels);
+  }
 
-    /* Converting sparse data into full matrix */
-    if (rSpec->dForm == full) {
-      double *p0, *p1;
+  /* Converting sparse data into full matrix */
+  if (rSpec->dForm == full) {
+    double *p0, *p1;
 
-      switch (symDim) {
-      case 0:
-        if (all == rSpec->dField) {
-          PROTECT(outValFull = allocVector(REALSXP, GMS_VAL_MAX));
-          rgdxAlloc++;
-          p0 = REAL(outValFull);
-          PROTECT(dimVect = allocVector(REALSXP, 1));
-          REAL(dimVect)[0] = 5;
-          PROTECT(dimNames = allocVector(VECSXP, 1));
-          SET_VECTOR_ELT(dimNames, 0, fieldUels);
-          setAttrib(outValFull, R_DimSymbol, dimVect);
+    switch (symDim) {
+    case 0:
+      if (all == rSpec->dField) {
+        double defRec[GMS_VAL_MAX];
+        int nFields = rSpec->fields.n;
+
+        PROTECT(outValFull = allocVector(REALSXP, nFields));
+        rgdxAlloc++;
+        p0 = REAL(outValFull);
+        PROTECT(dimVect = allocVector(REALSXP, 1));
+        REAL(dimVect)[0] = nFields;
+        PROTECT(dimNames = allocVector(VECSXP, 1));
+        SET_VECTOR_ELT(dimNames, 0, fieldUels);
+        setAttrib(outValFull, R_DimSymbol, dimVect);
+        if (R_NilValue != outDomains) {
+          setAttrib(dimNames, R_NamesSymbol, outDomains);
+        }
+        if (! reuseFilter) {
           if (R_NilValue != outDomains) {
-            setAttrib(dimNames, R_NamesSymbol, outDomains);
-          }
-          if (! reuseFilter) {
-            if (R_NilValue != outDomains) {
-              setAttrib(outUels, R_NamesSymbol, outDomains);
-            }
-          }
-          setAttrib(outValFull, R_DimNamesSymbol, dimNames);
-          UNPROTECT(2);
-          if (GMS_DT_VAR == symType)
-            getDefRecVar (typeCode, p0);
-          else {
-            getDefRecEqu (typeCode, p0);
-            /* error ("not yet implemented XX"); */
-          }
-          if (rSpec->withUel) {
-            /* assume matched is always set for filtered reads */
-            if (matched > 0) {
-              p1 = REAL(outValSp);
-              p1 += GMS_VAL_MAX; /* skip index column */
-              (void) memcpy (p0, p1, GMS_VAL_MAX * sizeof(double));
-            }
-          }
-          else {
-            if (mrows > 0) {
-              p1 = REAL(outValSp);
-              p1 += GMS_VAL_MAX; /* skip index column */
-              (void) memcpy (p0, p1, GMS_VAL_MAX * sizeof(double));
-            }
+            setAttrib(outUels, R_NamesSymbol, outDomains);
           }
         }
-        else {                  /* all != dField */
-          PROTECT(outValFull = allocVector(REALSXP, 1));
-          rgdxAlloc++;
-          p0 = REAL(outValFull);
-          *p0 = getDefVal (symType, typeCode, rSpec->dField);
-          if (rSpec->withUel) {
-            /* assume matched is always set for filtered reads */
-            /* if (outValSp != R_NilValue && (REAL(outValSp) != NULL)) { */
-            if (matched > 0) {
-              *p0 = REAL(outValSp)[0];
-            }
+        setAttrib(outValFull, R_DimNamesSymbol, dimNames);
+        UNPROTECT(2);
+        if (GMS_DT_VAR == symType)
+          getDefRecVar (typeCode, defRec);
+        else {
+          getDefRecEqu (typeCode, defRec);
+          /* error ("not yet implemented XX"); */
+        }
+        for (kk = 0;  kk < nFields;  kk++)
+          p0[kk] = defRec[rSpec->fields.idx[kk]];
+        if (rSpec->withUel) {
+          if (nnz > 0) {
+            p1 = REAL(outValSp);
+            if (! wideRows)
+              p1 += nFields; /* skip field column */
+            (void) memcpy (p0, p1, nFields * sizeof(double));
           }
-          else {
-            if (mrows > 0)
-              *p0 = REAL(outValSp)[0];
+        }
+        else {
+          if (mrows > 0) {
+            p1 = REAL(outValSp);
+            if (! wideRows)
+              p1 += nFields; /* skip field column */
+            (void) memcpy (p0, p1, nFields * sizeof(double));
           }
-        } /* all != dField */
-        /* sets cannot have symDim 0, so skip conversion of set text */
-        break;
-
-      case 1:
-        /* caution: for 1-dim params and vars with a single field, we return a matrix!
-         * it would be more consistent to return a 1-d array in these cases
-         */
-        PROTECT(dimVect = allocVector(REALSXP, 2));
-        rgdxAlloc++;
-        dimVal = REAL(dimVect);
-        PROTECT(dimNames = allocVector(VECSXP, 2)); /* for one-dim symbol, val is 2-dim */
+        }
+      }
+      else {                  /* all != dField */
+        PROTECT(outValFull = allocVector(REALSXP, 1));
         rgdxAlloc++;
-        if (all == rSpec->dField) {
-          dimVal[1] = 5;
-          SET_VECTOR_ELT(dimNames, 1, fieldUels);
+        p0 = REAL(outValFull);
+        *p0 = getDefVal (symType, typeCode, rSpec->dField);
+        if (rSpec->withUel) {
+          if (nnz > 0) {
+            *p0 = REAL(outValSp)[0];
+          }
         }
         else {
-          totalElement = 1;
-          dimVal[1] = 1;
-          SET_VECTOR_ELT(dimNames, 1, R_NilValue); /* no names for 2nd dimension */
+          if (mrows > 0)
+            *p0 = REAL(outValSp)[0];
         }
-        totalElement = dimVal[1];
+      } /* all != dField */
+      /* sets cannot have symDim 0, so skip conversion of set text */
+      break;
 
-        if (rSpec->withUel) {
-          SEXP dimNamesNames;
+    case 1:
+      /* caution: for 1-dim params and vars with a single field, we return a matrix!
+       * it would be more consistent to return a 1-d array in these cases
+       */
+      PROTECT(dimVect = allocVector(REALSXP, 2));
+      rgdxAlloc++;
+      dimVal = REAL(dimVect);
+      PROTECT(dimNames = allocVector(VECSXP, 2)); /* for one-dim symbol, val is 2-dim */
+      rgdxAlloc++;
+      if (all == rSpec->dField) {
+        dimVal[1] = rSpec->fields.n;
+        SET_VECTOR_ELT(dimNames, 1, fieldUels);
+      }
+      else {
+        totalElement = 1;
+        dimVal[1] = 1;
+        SET_VECTOR_ELT(dimNames, 1, R_NilValue); /* no names for 2nd dimension */
+      }
+      totalElement = dimVal[1];
 
-          dimVal[0] = length(VECTOR_ELT(rSpec->filterUel, 0));
-          totalElement *= dimVal[0];
+      if (rSpec->withUel) {
+        SEXP dimNamesNames;
+
+        dimVal[0] = length(VECTOR_ELT(rSpec->filterUel, 0));
+        totalElement *= dimVal[0];
+        PROTECT(outValFull = allocVector(REALSXP, totalElement));
+        rgdxAlloc++;
+        PROTECT(dimNamesNames = allocVector(STRSXP, 2));
+        if (R_NilValue == VECTOR_ELT(dimNames, 1)) /* no names for 2nd dimension */
+          SET_STRING_ELT(dimNamesNames, 1, mkChar(""));
+        else
+          SET_STRING_ELT(dimNamesNames, 1, mkChar("_field"));
+        SET_STRING_ELT(dimNamesNames, 0, STRING_ELT(outDomains, 0));
+        setAttrib(dimNames, R_NamesSymbol, dimNamesNames);
+        UNPROTECT(1);
+        if (reuseFilter) {
+          sparseToFull (outValSp, outValFull, rSpec->filterUel, symType,
+                        typeCode, rSpec->dField, &rSpec->fields, wideRows,
+                        mrows, symDimX);
+          setAttrib(rSpec->filterUel, R_NamesSymbol, outDomains);
+        }
+        else {
+          sparseToFull (outValSp, outValFull, outUels, symType,
+                        typeCode, rSpec->dField, &rSpec->fields, wideRows,
+                        mrows, symDimX);
+          setAttrib(outUels, R_NamesSymbol, outDomains);
+        }
+        setAttrib(outValFull, R_DimSymbol, dimVect);
+        SET_VECTOR_ELT(dimNames, 0, VECTOR_ELT(rSpec->filterUel, 0));
+        /* dimnamesnames done */
+        setAttrib(outValFull, R_DimNamesSymbol, dimNames);
+      }
+      else {
+        dimVal[0] = length(VECTOR_ELT(outUels, 0));
+        totalElement *= dimVal[0];
+        if (! directFull) {
           PROTECT(outValFull = allocVector(REALSXP, totalElement));
           rgdxAlloc++;
+          sparseToFull (outValSp, outValFull, outUels, symType,
+                        typeCode, rSpec->dField, &rSpec->fields, wideRows,
+                        mrows, symDimX);
+        }
+        setAttrib(outValFull, R_DimSymbol, dimVect);
+        SET_VECTOR_ELT(dimNames, 0, VECTOR_ELT(outUels, 0));
+        if (R_NilValue != outDomains) {
+          SEXP dimNamesNames;
           PROTECT(dimNamesNames = allocVector(STRSXP, 2));
-          if (R_NilValue == VECTOR_ELT(dimNames, 1)) /* no names for 2nd dimension */
+          if (R_NilValue == VECTOR_ELT(dimNames, 1)) { /* no names for 2nd dimension */
             SET_STRING_ELT(dimNamesNames, 1, mkChar(""));
-          else
+          }
+          else {
             SET_STRING_ELT(dimNamesNames, 1, mkChar("_field"));
+          }
           SET_STRING_ELT(dimNamesNames, 0, STRING_ELT(outDomains, 0));
           setAttrib(dimNames, R_NamesSymbol, dimNamesNames);
           UNPROTECT(1);
-          if (reuseFilter) {
-            sparseToFull (outValSp, outValFull, rSpec->filterUel, symType,
-                          typeCode, rSpec->dField, mrows, symDimX);
-            setAttrib(rSpec->filterUel, R_NamesSymbol, outDomains);
-          }
-          else {
-            sparseToFull (outValSp, outValFull, outUels, symType,
-                          typeCode, rSpec->dField, mrows, symDimX);
-            setAttrib(outUels, R_NamesSymbol, outDomains);
-          }
-          setAttrib(outValFull, R_DimSymbol, dimVect);
-          SET_VECTOR_ELT(dimNames, 0, VECTOR_ELT(rSpec->filterUel, 0));
-          /* dimnamesnames done */
-          setAttrib(outValFull, R_DimNamesSymbol, dimNames);
+          setAttrib(outUels, R_NamesSymbol, outDomains);
+        }
+        /* dimnamesnames done */
+        setAttrib(outValFull, R_DimNamesSymbol, dimNames);
+      }
+
+      if (rSpec->te) {   /* create full dimensional string matrix */
+        PROTECT(outTeFull = allocVector(STRSXP, dimVal[0]));
+        rgdxAlloc++;
+        if (rSpec->withUel) {
+          createElementMatrix (outValSp, outTeSp, outTeFull, rSpec->filterUel,
+                               symDim, nnz);
         }
         else {
-          dimVal[0] = length(VECTOR_ELT(outUels, 0));
-          totalElement *= dimVal[0];
-          PROTECT(outValFull = allocVector(REALSXP, totalElement));
-          rgdxAlloc++;
-          sparseToFull (outValSp, outValFull, outUels, symType,
-                        typeCode, rSpec->dField, mrows, symDimX);
-          setAttrib(outValFull, R_DimSymbol, dimVect);
-          SET_VECTOR_ELT(dimNames, 0, VECTOR_ELT(outUels, 0));
-          if (R_NilValue != outDomains) {
-            SEXP dimNamesNames;
-            PROTECT(dimNamesNames = allocVector(STRSXP, 2));
-            if (R_NilValue == VECTOR_ELT(dimNames, 1)) { /* no names for 2nd dimension */
-              SET_STRING_ELT(dimNamesNames, 1, mkChar(""));
-            }
-            else {
-              SET_STRING_ELT(dimNamesNames, 1, mkChar("_field"));
-            }
-            SET_STRING_ELT(dimNamesNames, 0, STRING_ELT(outDomains, 0));
-            setAttrib(dimNames, R_NamesSymbol, dimNamesNames);
-            UNPROTECT(1);
-            setAttrib(outUels, R_NamesSymbol, outDomains);
-          }
-          /* dimnamesnames done */
-          setAttrib(outValFull, R_DimNamesSymbol, dimNames);
+          createElementMatrix (outValSp, outTeSp, outTeFull, outUels,
+                               symDim, mrows);
         }
+        setAttrib(outTeFull, R_DimSymbol, dimVect); /* .te has same dimension as .val */
+        /* dimnamesnames done */
+        setAttrib(outTeFull, R_DimNamesSymbol, dimNames);
+      } /* if rSpec->te */
+      break;
 
-        if (rSpec->te) {   /* create full dimensional string matrix */
-          PROTECT(outTeFull = allocVector(STRSXP, dimVal[0]));
-          rgdxAlloc++;
-          if (rSpec->withUel) {
-            createElementMatrix (outValSp, outTeSp, outTeFull, rSpec->filterUel,
-                                 symDim, nnz);
-          }
-          else {
-            createElementMatrix (outValSp, outTeSp, outTeFull, outUels,
-                                 symDim, mrows);
-          }
-          setAttrib(outTeFull, R_DimSymbol, dimVect); /* .te has same dimension as .val */
-          /* dimnamesnames done */
-          setAttrib(outTeFull, R_DimNamesSymbol, dimNames);
-        } /* if rSpec->te */
-        break;
-
-      default:
-        PROTECT(dimVect = allocVector(REALSXP, symDimX));
+    default:
+      PROTECT(dimVect = allocVector(REALSXP, symDimX));
+      rgdxAlloc++;
+      totalElement = 1;
+      dimVal = REAL(dimVect);
+      if (reuseFilter) {
+        for (iDim = 0;  iDim < symDimX;  iDim++) {
+          dimVal[iDim] = length(VECTOR_ELT(rSpec->filterUel, iDim));
+          totalElement *= dimVal[iDim];
+        }
+        PROTECT(outValFull = allocVector(REALSXP, totalElement));
         rgdxAlloc++;
-        totalElement = 1;
-        dimVal = REAL(dimVect);
-        if (reuseFilter) {
-          for (iDim = 0;  iDim < symDimX;  iDim++) {
-            dimVal[iDim] = length(VECTOR_ELT(rSpec->filterUel, iDim));
-            totalElement *= dimVal[iDim];
-          }
+        sparseToFull (outValSp, outValFull, rSpec->filterUel, symType, typeCode,
+                      rSpec->dField, &rSpec->fields, wideRows, nnz,
+                      symDimX);
+        setAttrib(outValFull, R_DimSymbol, dimVect);
+        /* dimnamesnames done */
+        setAttrib(rSpec->filterUel, R_NamesSymbol, outDomains);
+        setAttrib(outValFull, R_DimNamesSymbol, rSpec->filterUel);
+      }
+      else {
+        for (iDim = 0;  iDim < symDimX;  iDim++) {
+          dimVal[iDim] = length(VECTOR_ELT(outUels, iDim));
+          totalElement *= dimVal[iDim];
+        }
+        if (! directFull) {
           PROTECT(outValFull = allocVector(REALSXP, totalElement));
           rgdxAlloc++;
-          sparseToFull (outValSp, outValFull, rSpec->filterUel, symType, typeCode,
-                        rSpec->dField, nnz, symDimX);
-          setAttrib(outValFull, R_DimSymbol, dimVect);
+          sparseToFull (outValSp, outValFull, outUels, symType, typeCode,
+                        rSpec->dField, &rSpec->fields, wideRows, mrows,
+                        symDimX);
+        }
+        setAttrib(outValFull, R_DimSymbol, dimVect);
+        if (R_NilValue != outDomains) {
+          setAttrib(outUels, R_NamesSymbol, outDomains);
+        }
+        /* dimnamesnames done */
+        setAttrib(outValFull, R_DimNamesSymbol, outUels);
+      }
+
+      if (rSpec->te) {   /* create full dimensional string matrix */
+        PROTECT(outTeFull = allocVector(STRSXP, totalElement));
+        rgdxAlloc++;
+        if (rSpec->withUel) {
+          createElementMatrix (outValSp, outTeSp, outTeFull, rSpec->filterUel, symDim, nnz);
+          setAttrib(outTeFull, R_DimSymbol, dimVect);
           /* dimnamesnames done */
-          setAttrib(rSpec->filterUel, R_NamesSymbol, outDomains);
-          setAttrib(outValFull, R_DimNamesSymbol, rSpec->filterUel);
+          setAttrib(outTeFull, R_DimNamesSymbol, rSpec->filterUel);
         }
         else {
-          for (iDim = 0;  iDim < symDimX;  iDim++) {
-            dimVal[iDim] = length(VECTOR_ELT(outUels, iDim));
-            totalElement *= dimVal[iDim];
-          }
-          PROTECT(outValFull = allocVector(REALSXP, totalElement));
-          rgdxAlloc++;
-          sparseToFull (outValSp, outValFull, outUels, symType, typeCode,
-                        rSpec->dField, mrows, symDimX);
-          setAttrib(outValFull, R_DimSymbol, dimVect);
-          if (R_NilValue != outDomains) {
-            setAttrib(outUels, R_NamesSymbol, outDomains);
-          }
+          createElementMatrix (outValSp, outTeSp, outTeFull, outUels, symDim, mrows);
+          setAttrib(outTeFull, R_DimSymbol, dimVect);
           /* dimnamesnames done */
-          setAttrib(outValFull, R_DimNamesSymbol, outUels);
+          setAttrib(outTeFull, R_DimNamesSymbol, outUels);
         }
+      } /* if rSpec->te */
+      break;
+    } /* switch(symDim) */
+  }   /* if dForm = full */
 
-        if (rSpec->te) {   /* create full dimensional string matrix */
-          PROTECT(outTeFull = allocVector(STRSXP, totalElement));
-          rgdxAlloc++;
-          if (rSpec->withUel) {
-            createElementMatrix (outValSp, outTeSp, outTeFull, rSpec->filterUel, symDim, nnz);
-            setAttrib(outTeFull, R_DimSymbol, dimVect);
-            /* dimnamesnames done */
-            setAttrib(outTeFull, R_DimNamesSymbol, rSpec->filterUel);
-          }
-          else {
-            createElementMatrix (outValSp, outTeSp, outTeFull, outUels, symDim, mrows);
-            setAttrib(outTeFull, R_DimSymbol, dimVect);
-            /* dimnamesnames done */
-            setAttrib(outTeFull, R_DimNamesSymbol, outUels);
-          }
-        } /* if rSpec->te */
-        break;
-      } /* switch(symDim) */
-    }   /* if dForm = full */
+  /* with index='integer', $val holds the sparse columns as vectors:
+   * the read loops fill them directly unless we compressed */
+  if (rSpec->intIndex && ! intCols) {
+    SEXP tmp = outValSp;
 
-    /* Creating output string for symbol name */
-    PROTECT(outName = allocVector(STRSXP, 1) );
-    SET_STRING_ELT(outName, 0, mkChar(symName));
-    rgdxAlloc++;
-    /* Creating output string for symbol type */
-    PROTECT(outType = allocVector(STRSXP, 1) );
+    PROTECT(outValSp = sparseToIntIndex (tmp, symDimX, nrows(tmp), nCols));
+    UNPROTECT_PTR(tmp);
+  }
+  /* with form='Matrix', $val is a compressed sparse column matrix */
+  if (rSpec->asMatrix) {
+    SEXP tmp = outValSp;
+
+    PROTECT(outValSp = sparseToCSC (tmp, nrows(tmp), nCols,
+                                    reuseFilter ? rSpec->filterUel : outUels,
+                                    outDomains));
+    UNPROTECT_PTR(tmp);
+  }
+
+  /* Creating output string for symbol name */
+  PROTECT(outName = allocVector(STRSXP, 1) );
+  SET_STRING_ELT(outName, 0, mkChar(symName));
+  rgdxAlloc++;
+  /* Creating output string for symbol type */
+  PROTECT(outType = allocVector(STRSXP, 1) );
+  rgdxAlloc++;
+  switch (symType) {
+  case GMS_DT_SET:
+    SET_STRING_ELT(outType, 0, mkChar(types[0]) );
+    break;
+  case GMS_DT_PAR:
+    SET_STRING_ELT(outType, 0, mkChar(types[1]) );
+    break;
+  case GMS_DT_VAR:
+    SET_STRING_ELT(outType, 0, mkChar(types[2]) );
+    break;
+  case GMS_DT_EQU:
+    SET_STRING_ELT(outType, 0, mkChar(types[3]) );
+    break;
+  default:
+    error("Unrecognized type of symbol found.");
+  }
+
+  /* Creating int vector for symbol dim */
+  PROTECT(outDim = allocVector(INTSXP, 1) );
+  INTEGER(outDim)[0] = symDim;
+  rgdxAlloc++;
+  /* Creating string vector for val data form */
+  PROTECT(outForm = allocVector(STRSXP, 1) );
+  rgdxAlloc++;
+  if (rSpec->dForm == full) {
+    SET_STRING_ELT(outForm, 0, mkChar(forms[0]));
+  }
+  else if (rSpec->asMatrix) {
+    SET_STRING_ELT(outForm, 0, mkChar(forms[2]));
+  }
+  else {
+    SET_STRING_ELT(outForm, 0, mkChar(forms[1]));
+  }
+
+  outElements++;       /* for $domains */
+  outElements++;       /* for $domInfo */
+
+  /* Create a string vector for symbol field */
+  if (symType == GMS_DT_VAR || symType == GMS_DT_EQU) {
+    outElements++;            /* for $field  */
+    PROTECT(outField = allocVector(STRSXP, 1));
     rgdxAlloc++;
-    switch (symType) {
-    case GMS_DT_SET:
-      SET_STRING_ELT(outType, 0, mkChar(types[0]) );
+    switch(rSpec->dField) {
+    case level:
+      SET_STRING_ELT(outField, 0, mkChar (fields[GMS_VAL_LEVEL]));
       break;
-    case GMS_DT_PAR:
-      SET_STRING_ELT(outType, 0, mkChar(types[1]) );
+    case marginal:
+      SET_STRING_ELT(outField, 0, mkChar (fields[GMS_VAL_MARGINAL]));
       break;
-    case GMS_DT_VAR:
-      SET_STRING_ELT(outType, 0, mkChar(types[2]) );
+    case lower:
+      SET_STRING_ELT(outField, 0, mkChar (fields[GMS_VAL_LOWER]));
       break;
-    case GMS_DT_EQU:
-      SET_STRING_ELT(outType, 0, mkChar(types[3]) );
+    case upper:
+      SET_STRING_ELT(outField, 0, mkChar (fields[GMS_VAL_UPPER]));
+      break;
+    case scale:
+      SET_STRING_ELT(outField, 0, mkChar (fields[GMS_VAL_SCALE]));
+      break;
+    case all:
+      SET_STRING_ELT(outField, 0, mkChar (fields[GMS_VAL_MAX]));
+      for (kk = 0;  kk < rSpec->fields.n;  kk++) {
+        if (kk != rSpec->fields.idx[kk])
+          break;
+      }
+      if (kk < GMS_VAL_MAX)     /* several fields: $field lists them */
+        outField = fieldUels;
       break;
     default:
-      error("Unrecognized type of symbol found.");
-    }
-
-    /* Creating int vector for symbol dim */
-    PROTECT(outDim = allocVector(INTSXP, 1) );
-    INTEGER(outDim)[0] = symDim;
-    rgdxAlloc++;
-    /* Creating string vector for val data form */
-    PROTECT(outForm = allocVector(STRSXP, 1) );
-    rgdxAlloc++;
-    if (rSpec->dForm == full) {
-      SET_STRING_ELT(outForm, 0, mkChar(forms[0]));
-    }
-    else {
-      SET_STRING_ELT(outForm, 0, mkChar(forms[1]));
+      error("Unrecognized type of field found.");
     }
-
-    outElements++;       /* for $domains */
-    outElements++;       /* for $domInfo */
-
-    /* Create a string vector for symbol field */
-    if (symType == GMS_DT_VAR || symType == GMS_DT_EQU) {
-      outElements++;            /* for $field  */
-      PROTECT(outField = allocVector(STRSXP, 1));
-      rgdxAlloc++;
-      switch(rSpec->dField) {
-      case level:
-        SET_STRING_ELT(outField, 0, mkChar (fields[GMS_VAL_LEVEL]));
-        break;
-      case marginal:
-        SET_STRING_ELT(outField, 0, mkChar (fields[GMS_VAL_MARGINAL]));
-        break;
-      case lower:
-        SET_STRING_ELT(outField, 0, mkChar (fields[GMS_VAL_LOWER]));
-        break;
-      case upper:
-        SET_STRING_ELT(outField, 0, mkChar (fields[GMS_VAL_UPPER]));
-        break;
-      case scale:
-        SET_STRING_ELT(outField, 0, mkChar (fields[GMS_VAL_SCALE]));
-        break;
-      case all:
-        SET_STRING_ELT(outField, 0, mkChar (fields[GMS_VAL_MAX]));
-        break;
-      default:
-        error("Unrecognized type of field found.");
-      }
-      if (GMS_DT_VAR == symType)
-        outElements++;            /* one for $varTypeText */
-      outElements++;            /* one for $typeCode */
-    } /* symbol is var or equ */
-    if (rSpec->ts) {
-      outElements++;
-      PROTECT(outTs = allocVector(STRSXP, 1));
+    if (GMS_DT_VAR == symType)
+      outElements++;            /* one for $varTypeText */
+    outElements++;            /* one for $typeCode */
+    if (rSpec->wide && (sparse == rSpec->dForm)) {
+      outElements++;            /* for $layout: wgdx reads it back */
+      PROTECT(outLayout = mkString("wide"));
       rgdxAlloc++;
-      SET_STRING_ELT(outTs, 0, mkChar(symText));
-    }
-    if (rSpec->te) {
-      outElements++;
     }
-  } /* if (withList) aa */
-  else {
-    /* no requestList was input, so returning universe */
-    /* Creating output string symbol name */
-    PROTECT(outName = allocVector(STRSXP, 1));
-    SET_STRING_ELT(outName, 0, mkChar("*"));
-    rgdxAlloc++;
-    /* Creating output string for symbol type */
-    PROTECT(outType = allocVector(STRSXP, 1));
-    rgdxAlloc++;
-    SET_STRING_ELT(outType, 0, mkChar(types[0]));
-    /* Creating int vector for symbol dim */
-    PROTECT(outDim = allocVector(INTSXP, 1));
-    INTEGER(outDim)[0] = 1;
+  } /* symbol is var or equ */
+  if (rSpec->ts) {
+    outElements++;
+    PROTECT(outTs = allocVector(STRSXP, 1));
     rgdxAlloc++;
+    SET_STRING_ELT(outTs, 0, mkChar(symText));
+  }
+  if (rSpec->te) {
+    outElements++;
   }
 
   PROTECT(outListNames = allocVector(STRSXP, outElements));
@@ -1488,26 +2969,27 @@ SEXP rgdx (SEXP args)
   SET_STRING_ELT(outListNames, iElement, mkChar("val"));  iElement++;
   SET_STRING_ELT(outListNames, iElement, mkChar("form"));  iElement++;
   SET_STRING_ELT(outListNames, iElement, mkChar("uels"));  iElement++;
-  if (withList) {
-    SET_STRING_ELT(outListNames, iElement, mkChar("domains"));  iElement++;
-    SET_STRING_ELT(outListNames, iElement, mkChar("domInfo"));  iElement++;
-    if (symType == GMS_DT_VAR || symType == GMS_DT_EQU) {
-      SET_STRING_ELT(outListNames, iElement, mkChar("field"));  iElement++;
-      if (GMS_DT_VAR == symType) {
-        SET_STRING_ELT(outListNames, iElement, mkChar("varTypeText"));
-        iElement++;
-      }
-      SET_STRING_ELT(outListNames, iElement, mkChar("typeCode"));  iElement++;
-    }
-    if (rSpec->ts) {
-      SET_STRING_ELT(outListNames, iElement, mkChar("ts"));
+  SET_STRING_ELT(outListNames, iElement, mkChar("domains"));  iElement++;
+  SET_STRING_ELT(outListNames, iElement, mkChar("domInfo"));  iElement++;
+  if (symType == GMS_DT_VAR || symType == GMS_DT_EQU) {
+    SET_STRING_ELT(outListNames, iElement, mkChar("field"));  iElement++;
+    if (GMS_DT_VAR == symType) {
+      SET_STRING_ELT(outListNames, iElement, mkChar("varTypeText"));
       iElement++;
     }
-    if (rSpec->te) {
-      SET_STRING_ELT(outListNames, iElement, mkChar("te"));
-      iElement++;
+    SET_STRING_ELT(outListNames, iElement, mkChar("typeCode"));  iElement++;
+    if (R_NilValue != outLayout) {
+      SET_STRING_ELT(outListNames, iElement, mkChar("layout"));  iElement++;
     }
   }
+  if (rSpec->ts) {
+    SET_STRING_ELT(outListNames, iElement, mkChar("ts"));
+    iElement++;
+  }
+  if (rSpec->te) {
+    SET_STRING_ELT(outListNames, iElement, mkChar("te"));
+    iElement++;
+  }
   if (iElement != outElements)
     error ("Internal error creating outListNames: iElement = %d  outElements = %d",
            iElement, outElements);
@@ -1520,58 +3002,51 @@ SEXP rgdx (SEXP args)
   SET_VECTOR_ELT(outList, iElement, outName);  iElement++;
   SET_VECTOR_ELT(outList, iElement, outType);  iElement++;
   SET_VECTOR_ELT(outList, iElement, outDim);  iElement++;
-  if (withList) {
-    if (rSpec->dForm == full) {
-      SET_VECTOR_ELT(outList, iElement, outValFull);  iElement++;
-    }
-    else {
-      SET_VECTOR_ELT(outList, iElement, outValSp);    iElement++;
-    }
-    SET_VECTOR_ELT(outList, iElement, outForm);       iElement++;
-    if (reuseFilter) {
-      SET_VECTOR_ELT(outList, iElement, rSpec->filterUel);  iElement++;
-    }
-    else {
-      SET_VECTOR_ELT(outList, iElement, outUels);    iElement++;
-    }
-    SET_VECTOR_ELT(outList, iElement, outDomains);   iElement++;
-    SET_STRING_ELT(outDomInfo, 0, mkChar(domInfoSrc));
-    SET_VECTOR_ELT(outList, iElement, outDomInfo);   iElement++;
-
-    if (symType == GMS_DT_VAR || symType == GMS_DT_EQU) {
-      SET_VECTOR_ELT(outList, iElement, outField);   iElement++;
+  if (rSpec->dForm == full) {
+    SET_VECTOR_ELT(outList, iElement, outValFull);  iElement++;
+  }
+  else {
+    SET_VECTOR_ELT(outList, iElement, outValSp);    iElement++;
+  }
+  SET_VECTOR_ELT(outList, iElement, outForm);       iElement++;
+  if (reuseFilter) {
+    SET_VECTOR_ELT(outList, iElement, rSpec->filterUel);  iElement++;
+  }
+  else {
+    SET_VECTOR_ELT(outList, iElement, outUels);    iElement++;
+  }
+  SET_VECTOR_ELT(outList, iElement, outDomains);   iElement++;
+  SET_STRING_ELT(outDomInfo, 0, mkChar(domInfoSrc));
+  SET_VECTOR_ELT(outList, iElement, outDomInfo);   iElement++;
 
-      if (GMS_DT_VAR == symType) {
-        PROTECT(tmpExp = allocVector(STRSXP, 1));
-        SET_STRING_ELT(tmpExp, 0, mkChar(gmsVarTypeText[typeCode]));
-        SET_VECTOR_ELT(outList, iElement, tmpExp);   iElement++;
-        UNPROTECT(1);
-      }
+  if (symType == GMS_DT_VAR || symType == GMS_DT_EQU) {
+    SET_VECTOR_ELT(outList, iElement, outField);   iElement++;
 
-      PROTECT(tmpExp = allocVector(INTSXP, 1));
-      INTEGER(tmpExp)[0] = typeCode;
-      SET_VECTOR_ELT(outList, iElement, tmpExp);     iElement++;
+    if (GMS_DT_VAR == symType) {
+      PROTECT(tmpExp = allocVector(STRSXP, 1));
+      SET_STRING_ELT(tmpExp, 0, mkChar(gmsVarTypeText[typeCode]));
+      SET_VECTOR_ELT(outList, iElement, tmpExp);   iElement++;
       UNPROTECT(1);
     }
-    if (rSpec->ts) {
-      SET_VECTOR_ELT(outList, iElement, outTs);      iElement++;
-    }
-    if (rSpec->te) {
-      if (rSpec->dForm == full) {
-        SET_VECTOR_ELT(outList, iElement, outTeFull); iElement++;
-      }
-      else {
-        SET_VECTOR_ELT(outList, iElement, outTeSp);   iElement++;
-      }
+
+    PROTECT(tmpExp = allocVector(INTSXP, 1));
+    INTEGER(tmpExp)[0] = typeCode;
+    SET_VECTOR_ELT(outList, iElement, tmpExp);     iElement++;
+    UNPROTECT(1);
+    if (R_NilValue != outLayout) {
+      SET_VECTOR_ELT(outList, iElement, outLayout);  iElement++;
     }
   }
-  else {
-    /* no read specifier so return the universe */
-    /* entering null values if nothing else makes sense */
-    SET_VECTOR_ELT(outList, iElement, R_NilValue);      iElement++;
-
-    SET_VECTOR_ELT(outList, iElement, R_NilValue);      iElement++;
-    SET_VECTOR_ELT(outList, iElement, universe);        iElement++;
+  if (rSpec->ts) {
+    SET_VECTOR_ELT(outList, iElement, outTs);      iElement++;
+  }
+  if (rSpec->te) {
+    if (rSpec->dForm == full) {
+      SET_VECTOR_ELT(outList, iElement, outTeFull); iElement++;
+    }
+    else {
+      SET_VECTOR_ELT(outList, iElement, outTeSp);   iElement++;
+    }
   }
   if (iElement != outElements)
     error ("Internal error creating outList: iElement = %d  outElements = %d",
@@ -1580,17 +3055,377 @@ SEXP rgdx (SEXP args)
   /* Setting attribute name */
   setAttrib(outList, R_NamesSymbol, outListNames);
   /* Releasing allocated memory */
+  for (iDim = 0;  iDim < GMS_MAX_INDEX_DIM;  iDim++) {
+    free (hpFilter[iDim].idx);
+    free (hpFilter[iDim].lookup.pos);
+    free (xpFilter[iDim].idx);
+    free (xpFilter[iDim].lookup.pos);
+  }
   free(rSpec);
-#if 0
-  if (!gdxDataReadDone (gdxHandle)) {
-    error ("Could not gdxDataReadDone");
+  UNPROTECT(rgdxAlloc);
+  return outList;
+} /* readSymbol */
+
+/* isBatchRequest: return TRUE if requestList is a list of read
+ * specifiers, e.g. list(list(name='x'), list(name='y',field='m')),
+ * rather than a single read specifier
+ */
+static Rboolean
+isBatchRequest (SEXP requestList)
+{
+  int i, n;
+
+  n = length(requestList);
+  if (n < 1)
+    return FALSE;
+  for (i = 0;  i < n;  i++) {
+    if (TYPEOF(VECTOR_ELT(requestList, i)) != VECSXP)
+      return FALSE;
+  }
+  return TRUE;
+} /* isBatchRequest */
+
+/* requestName: return the 'name' element of a read specifier
+ * that has already been checked by checkRgdxList
+ */
+static const char *
+requestName (SEXP request)
+{
+  SEXP lstNames;
+  int i;
+
+  lstNames = getAttrib(request, R_NamesSymbol);
+  for (i = 0;  i < length(request);  i++) {
+    if (0 == strcmp("name", CHAR(STRING_ELT(lstNames, i))))
+      return CHAR(STRING_ELT(VECTOR_ELT(request, i), 0));
+  }
+  return "";
+} /* requestName */
+
+/* readBatch: read each symbol requested in the list of read specifiers
+ * requestList from the GDX file open in gdxHandle
+ * return a list of results named by symbol, unprotected
+ */
+static SEXP
+readBatch (const char *gdxFileName, SEXP requestList, Rboolean squeezeDef,
+           Rboolean useDomInfo, Rboolean followAlias, SEXP fileCache,
+           SEXP reader)
+{
+  SEXP outList, outListNames, request;
+  int i, n;
+
+  n = length(requestList);
+  PROTECT(outList = allocVector(VECSXP, n));
+  PROTECT(outListNames = allocVector(STRSXP, n));
+  for (i = 0;  i < n;  i++) {
+    request = VECTOR_ELT(requestList, i);
+    SET_VECTOR_ELT(outList, i,
+                   readSymbol (gdxFileName, request, squeezeDef,
+                               useDomInfo, followAlias, fileCache, reader));
+    SET_STRING_ELT(outListNames, i, mkChar(requestName(request)));
+  }
+  setAttrib(outList, R_NamesSymbol, outListNames);
+  UNPROTECT(2);
+  return outList;
+} /* readBatch */
+
+/* beginRead: make the GDX file named by fileName the one in gdxHandle
+ * fileName: the gdxName arg to rgdx, a file name or a gdxReader
+ * rdr: the gdxReader if fileName is one, NULL o/w
+ * return the per-file cache shared by reads from this file, unprotected
+ */
+static SEXP
+beginRead (SEXP fileName, gdxReader_t *rdr, shortStringBuf_t gdxFileName)
+{
+  SEXP fileCache;
+
+  if (rdr) {
+    /* file is already open: pick up where the last read left off */
+    gdxReaderBegin (rdr);
+    return R_ExternalPtrProtected (fileName);
+  }
+  openGDXRead (gdxFileName);
+  PROTECT(fileCache = allocVector(VECSXP, FCACHE_LEN));
+  SET_VECTOR_ELT(fileCache, FCACHE_FILEID, mkFileId (gdxFileName));
+  UNPROTECT(1);
+  return fileCache;
+} /* beginRead */
+
+/* endRead: counterpart to beginRead, called after a successful read */
+static void
+endRead (gdxReader_t *rdr)
+{
+  int errNum;
+
+  if (rdr) {
+    gdxReaderEnd (rdr);
+    return;
   }
-#endif
   errNum = gdxClose (gdxHandle);
   if (errNum != 0) {
     error("Errors detected when closing gdx file");
   }
   (void) gdxFree (&gdxHandle);
-  UNPROTECT(rgdxAlloc);
+} /* endRead */
+
+typedef struct lazyRead {      /* args to readLazyVal, for doLazyRead */
+  SEXP reader;
+  SEXP request;
+  Rboolean squeezeDef;
+  Rboolean useDomInfo;
+} lazyRead_t;
+
+/* doLazyRead: the body of readLazyVal, run via R_ExecWithCleanup */
+static SEXP
+doLazyRead (void *data)
+{
+  lazyRead_t *lr = (lazyRead_t *) data;
+  SEXP fileCache, sym;
+  gdxReader_t *rdr;
+  shortStringBuf_t gdxFileName;
+
+  rdr = getGdxReader (lr->reader);
+  (void) CHAR2ShortStr (rdr->fileName, gdxFileName);
+  PROTECT(fileCache = beginRead (lr->reader, rdr, gdxFileName));
+  PROTECT(sym = readSymbol (gdxFileName, lr->request, lr->squeezeDef,
+                            lr->useDomInfo, TRUE, fileCache, lr->reader));
+  endRead (rdr);
+  UNPROTECT(2);                 /* sym, fileCache */
+  return VECTOR_ELT(sym, 3);    /* $val */
+} /* doLazyRead */
+
+/* restoreGdxHandle: cleanup for doLazyRead */
+static void
+restoreGdxHandle (void *data)
+{
+  gdxHandle = *(gdxHandle_t *) data;
+} /* restoreGdxHandle */
+
+/* readLazyVal: read the $val of a lazy rgdx result, see lazyVal.c
+ * reader: the gdxReader the lazy result was read from
+ * request: the read specifier, without 'lazy'
+ * return $val, unprotected
+ * A lazy $val can be used inside another gateway, e.g. wgdx with its
+ * own file open in gdxHandle, so gdxHandle is restored when we are done,
+ * also if the read fails.
+ */
+SEXP
+readLazyVal (SEXP reader, SEXP request, Rboolean squeezeDef,
+             Rboolean useDomInfo)
+{
+  lazyRead_t lr;
+  gdxHandle_t prevHandle;
+
+  lr.reader = reader;
+  lr.request = request;
+  lr.squeezeDef = squeezeDef;
+  lr.useDomInfo = useDomInfo;
+  prevHandle = gdxHandle;
+  return R_ExecWithCleanup (doLazyRead, &lr, restoreGdxHandle, &prevHandle);
+} /* readLazyVal */
+
+/* rgdx: gateway function for reading gdx, called from R via .External
+ * first argument <- gdx file name, or a gdxReader holding the file open
+ * second argument <- requestList containing several elements
+ * that make up a read specifier, e.g. symbol name, dim, form, etc
+ * third argument <- squeeze specifier
+ * fourth argument <- useDomInfo specifier
+ * fifth argument <- followAlias specifier
+ * ------------------------------------------------------------------ */
+SEXP rgdx (SEXP args)
+{
+  const char *funcName = "rgdx";
+  SEXP fileName, requestList, squeezeExp, udi, followAliasExp;
+  SEXP targs;
+  SEXP fileCache;               /* per-file cache for this GDX file */
+  SEXP outList;
+  gdxReader_t *rdr = NULL;      /* non-NULL if reading via a gdxReader */
+  shortStringBuf_t gdxFileName;
+  int arglen;
+  int withList = 0;
+  Rboolean squeezeDef = NA_LOGICAL; /* squeeze out default records */
+  Rboolean useDomInfo = NA_LOGICAL;
+  Rboolean followAlias = NA_LOGICAL;
+
+  /* first arg is function name - ignore it */
+  arglen = length(args);
+
+  /* ----------------- Check proper number of inputs and outputs ------------
+   * Function should follow specification of
+   * rgdx ('gdxFileName', requestList = NULL, squeeze = TRUE, useDomInfo=TRUE,
+   *       followAlias=TRUE)
+   * ------------------------------------------------------------------------ */
+  if (6 != arglen) {
+    error ("usage: %s(gdxName, requestList = NULL, squeeze = TRUE,"
+           " useDomInfo = TRUE, followAlias = TRUE) - incorrect arg count",
+           funcName);
+  }
+  targs = CDR(args);
+  fileName       = CAR(targs);  targs = CDR(targs);
+  requestList    = CAR(targs);  targs = CDR(targs);
+  squeezeExp     = CAR(targs);  targs = CDR(targs);
+  udi            = CAR(targs);  targs = CDR(targs);
+  followAliasExp = CAR(targs);  targs = CDR(targs);
+  if (EXTPTRSXP == TYPEOF(fileName)) {
+    rdr = getGdxReader (fileName);
+  }
+  else if (TYPEOF(fileName) != STRSXP) {
+    error ("usage: %s(gdxName, requestList = NULL) - gdxName must be a string or gdxReader", funcName);
+  }
+  if (TYPEOF(requestList) == NILSXP)
+    withList = 0;
+  else {
+    withList = 1;
+    if (TYPEOF(requestList) != VECSXP) {
+      error ("usage: %s(gdxName, requestList, squeeze, useDomInfo) - requestList must be a list", funcName);
+    }
+  }
+
+  if (rdr)
+    (void) CHAR2ShortStr (rdr->fileName, gdxFileName);
+  else {
+    (void) CHAR2ShortStr (CHAR(STRING_ELT(fileName, 0)), gdxFileName);
+
+    if (! withList) {
+      if (0 == strcmp("?", gdxFileName)) {
+        Rprintf ("For version information, try packageVersion('gdxrrw')\n");
+        return R_NilValue;
+      } /* if audit run */
+    } /* if one arg, of character type */
+  }
+
+  squeezeDef = exp2Boolean (squeezeExp);
+  if (NA_LOGICAL == squeezeDef) {
+    error ("usage: %s(gdxName, requestList, squeeze = TRUE, useDomInfo = TRUE)\n    squeeze argument could not be interpreted as logical", funcName);
+  }
+  useDomInfo = exp2Boolean (udi);
+  if (NA_LOGICAL == useDomInfo) {
+    error ("usage: %s(gdxName, requestList, squeeze = TRUE, useDomInfo = TRUE)\n    useDomInfo argument could not be interpreted as logical", funcName);
+  }
+  followAlias = exp2Boolean (followAliasExp);
+  if (NA_LOGICAL == followAlias) {
+    error ("usage: %s(gdxName, requestList, squeeze = TRUE, useDomInfo = TRUE, followAlias = TRUE)\n    followAlias argument could not be interpreted as logical", funcName);
+  }
+
+  PROTECT(fileCache = beginRead (fileName, rdr, gdxFileName));
+
+  if (! withList)
+    outList = universeReturn (getUniverse (fileCache));
+  else if (isBatchRequest (requestList))
+    outList = readBatch (gdxFileName, requestList, squeezeDef,
+                         useDomInfo, followAlias, fileCache,
+                         rdr ? fileName : R_NilValue);
+  else
+    outList = readSymbol (gdxFileName, requestList, squeezeDef,
+                          useDomInfo, followAlias, fileCache,
+                          rdr ? fileName : R_NilValue);
+  PROTECT(outList);
+
+  endRead (rdr);
+  UNPROTECT(2);                 /* outList, fileCache */
   return outList;
 } /* End of rgdx */
+
+/* rgdxAll: gateway function for reading all symbols of the requested
+ * types from a GDX file, called from R via .External
+ * first argument <- gdx file name or gdxReader
+ * second argument <- character vector of symbol types to read
+ * third argument <- squeeze specifier
+ * fourth argument <- useDomInfo specifier
+ * return: list of symbols in rgdx list form, named by symbol
+ */
+SEXP rgdxAll (SEXP args)
+{
+  const char *funcName = "rgdx.all";
+  SEXP fileName, typesExp, squeezeExp, udi;
+  SEXP targs;
+  SEXP fileCache;               /* per-file cache for this GDX file */
+  SEXP outList, outListNames, request, requestNames;
+  gdxReader_t *rdr = NULL;      /* non-NULL if reading via a gdxReader */
+  shortStringBuf_t gdxFileName, symName;
+  const char *typeName;
+  char *types[] = {"set", "parameter", "variable", "equation"};
+  int wantType[GMS_DT_ALIAS+1];
+  int i, k, nSyms, nUels, iSym, symDim, symType, nOut;
+  Rboolean squeezeDef = NA_LOGICAL; /* squeeze out default records */
+  Rboolean useDomInfo = NA_LOGICAL;
+
+  if (5 != length(args)) {
+    error ("usage: %s(gdxName, env, types, squeeze = TRUE,"
+           " useDomInfo = TRUE) - incorrect arg count", funcName);
+  }
+  targs = CDR(args);
+  fileName       = CAR(targs);  targs = CDR(targs);
+  typesExp       = CAR(targs);  targs = CDR(targs);
+  squeezeExp     = CAR(targs);  targs = CDR(targs);
+  udi            = CAR(targs);  targs = CDR(targs);
+  if (EXTPTRSXP == TYPEOF(fileName)) {
+    rdr = getGdxReader (fileName);
+  }
+  else if (TYPEOF(fileName) != STRSXP) {
+    error ("usage: %s(gdxName, env, types) - gdxName must be a string or gdxReader", funcName);
+  }
+  if (TYPEOF(typesExp) != STRSXP) {
+    error ("usage: %s(gdxName, env, types) - types must be a character vector", funcName);
+  }
+  memset (wantType, 0, sizeof(wantType));
+  for (i = 0;  i < length(typesExp);  i++) {
+    typeName = CHAR(STRING_ELT(typesExp, i));
+    for (k = 0;  k < 4;  k++) {
+      if (0 == strcmp(types[k], typeName))
+        break;
+    }
+    if (k >= 4) {
+      error ("usage: %s(gdxName, env, types) - unknown symbol type '%s'",
+             funcName, typeName);
+    }
+    wantType[k] = 1;            /* GMS_DT_SET == 0, ..., GMS_DT_EQU == 3 */
+  }
+  squeezeDef = exp2Boolean (squeezeExp);
+  if (NA_LOGICAL == squeezeDef) {
+    error ("usage: %s(gdxName, env, types, squeeze = TRUE, useDomInfo = TRUE)\n    squeeze argument could not be interpreted as logical", funcName);
+  }
+  useDomInfo = exp2Boolean (udi);
+  if (NA_LOGICAL == useDomInfo) {
+    error ("usage: %s(gdxName, env, types, squeeze = TRUE, useDomInfo = TRUE)\n    useDomInfo argument could not be interpreted as logical", funcName);
+  }
+  if (rdr)
+    (void) CHAR2ShortStr (rdr->fileName, gdxFileName);
+  else
+    (void) CHAR2ShortStr (CHAR(STRING_ELT(fileName, 0)), gdxFileName);
+
+  PROTECT(fileCache = beginRead (fileName, rdr, gdxFileName));
+  (void) gdxSystemInfo (gdxHandle, &nSyms, &nUels);
+  nOut = 0;
+  for (iSym = 1;  iSym <= nSyms;  iSym++) {
+    gdxSymbolInfo (gdxHandle, iSym, symName, &symDim, &symType);
+    if ((symType >= 0) && (symType < GMS_DT_ALIAS) && wantType[symType])
+      nOut++;
+  }
+
+  PROTECT(outList = allocVector(VECSXP, nOut));
+  PROTECT(outListNames = allocVector(STRSXP, nOut));
+  /* one read specifier list(name=symName), reused for every symbol */
+  PROTECT(request = allocVector(VECSXP, 1));
+  PROTECT(requestNames = allocVector(STRSXP, 1));
+  SET_STRING_ELT(requestNames, 0, mkChar("name"));
+  setAttrib(request, R_NamesSymbol, requestNames);
+  k = 0;
+  for (iSym = 1;  iSym <= nSyms;  iSym++) {
+    gdxSymbolInfo (gdxHandle, iSym, symName, &symDim, &symType);
+    if ((symType < 0) || (symType >= GMS_DT_ALIAS) || ! wantType[symType])
+      continue;
+    SET_VECTOR_ELT(request, 0, mkString(symName));
+    SET_VECTOR_ELT(outList, k,
+                   readSymbol (gdxFileName, request, squeezeDef,
+                               useDomInfo, TRUE, fileCache,
+                               rdr ? fileName : R_NilValue));
+    SET_STRING_ELT(outListNames, k, mkChar(symName));
+    k++;
+  }
+  setAttrib(outList, R_NamesSymbol, outListNames);
+
+  endRead (rdr);
+  UNPROTECT(5);                 /* requestNames, request, outListNames, outList, fileCache */
+  return outList;
+} /* rgdxAll */
@@ -0,0 +1,174 @@
+/* symToDF.c
+ * code for building the data frames returned by rgdx.param, rgdx.set,
+ * rgdx.var and rgdx.equ
+ *
+ * Copyright (c) 2010-2021 GAMS Development Corp. <support@gams.com>
+ * Copyright (c) 2010-2021 GAMS Software GmbH <support@gams.com>
+ *
+ * This program and the accompanying materials are made available
+ * under the terms of the Eclipse Public License 2.0 which is
+ * available at  http://www.eclipse.org/legal/epl-2.0.
+ *
+ * This Source Code may also be made available under the following
+ * Secondary Licenses when the conditions for such availability set
+ * forth in the Eclipse Public License, v. 2.0 are satisfied:
+ * GNU General Public License, version 2 or later
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR GPL-2.0-or-later
+ */
+
+#include <R.h>
+#include <Rinternals.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "gdxcc.h"
+#include "gclgms.h"
+#include "globals.h"
+
+/* symElt: return the element of the rgdx list sym named eltName,
+ * or R_NilValue if there is no such element
+ */
+static SEXP
+symElt (SEXP sym, const char *eltName)
+{
+  SEXP symNames = getAttrib(sym, R_NamesSymbol);
+  int i;
+
+  for (i = 0;  i < length(sym);  i++) {
+    if (0 == strcmp(eltName, CHAR(STRING_ELT(symNames, i))))
+      return VECTOR_ELT(sym, i);
+  }
+  return R_NilValue;
+} /* symElt */
+
+/* mkFactor: return a factor with codes from column kCol of the
+ * nRec x nCols sparse $val p, and levels uels
+ */
+static SEXP
+mkFactor (const double *p, int nRec, int kCol, SEXP uels)
+{
+  SEXP f, cls;
+  const double *from;
+  int *codes;
+  int k, nUels;
+
+  nUels = length(uels);
+  PROTECT(f = allocVector(INTSXP, nRec));
+  codes = INTEGER(f);
+  from = p + (size_t)kCol * nRec;
+  for (k = 0;  k < nRec;  k++) {
+    codes[k] = (int) from[k];
+    if ((codes[k] < 1) || (codes[k] > nUels))
+      error ("symToDF: index %d in column %d is not a valid UEL position",
+             codes[k], kCol+1);
+  }
+  if (nRec > 0)
+    setAttrib(f, R_LevelsSymbol, uels);
+  else                          /* as for factor(numeric(0)) */
+    setAttrib(f, R_LevelsSymbol, allocVector(STRSXP, 0));
+  PROTECT(cls = mkString("factor"));
+  setAttrib(f, R_ClassSymbol, cls);
+  UNPROTECT(2);
+  return f;
+} /* mkFactor */
+
+/* symToDF: gateway function for converting a symbol read by rgdx
+ * into a data frame, called from R via .External
+ * first argument <- symbol in rgdx list form, sparse
+ * second argument <- names of the data frame columns
+ * third argument <- logical: include $te as a column
+ * fourth argument <- logical: include $ts as an attribute
+ * return: data frame with a factor per index position, a field factor
+ *   for variables and equations read with several fields, the value
+ *   column for all but sets (one per field with layout='wide'),
+ *   and the .te column for sets if requested
+ */
+SEXP
+symToDF (SEXP args)
+{
+  const char *funcName = "symToDF";
+  SEXP sym, colNames, val, uels, df, col, rowNames, domInfo;
+  Rboolean wantTe, wantTs;
+  int symDim, nRec, nCols, kCol, isPar, isVarEqu, nIdx, nVals;
+  const char *symType;
+  double *p;
+
+  if (5 != length(args)) {
+    error ("usage: %s(sym, names, te, ts) - incorrect arg count", funcName);
+  }
+  sym = CADR(args);
+  colNames = CADDR(args);
+  wantTe = asLogical(CADDDR(args));
+  wantTs = asLogical(CAD4R(args));
+  if (VECSXP != TYPEOF(sym))
+    error ("usage: %s(sym, names, te, ts) - sym must be a list", funcName);
+  if (STRSXP != TYPEOF(colNames))
+    error ("usage: %s(sym, names, te, ts) - names must be a character vector",
+           funcName);
+
+  symDim = asInteger(symElt(sym, "dim"));
+  symType = CHAR(STRING_ELT(symElt(sym, "type"), 0));
+  /* variables and equations have a value column, like parameters */
+  isPar = (0 != strcmp("set", symType));
+  val = symElt(sym, "val");
+  uels = symElt(sym, "uels");
+  isVarEqu = ((0 == strcmp("variable", symType)) ||
+              (0 == strcmp("equation", symType)));
+  if (REALSXP != TYPEOF(val))
+    error ("%s: sym must be in sparse rgdx form", funcName);
+  /* with several fields, the field is one more index column,
+   * or with layout='wide' each field has a value column */
+  nIdx = length(uels);
+  nVals = isPar ? ncols(val) - nIdx : 0;
+  if (((nIdx != symDim) && ((nIdx != symDim+1) || ! isVarEqu)) ||
+      (isPar && (nVals != 1) && ((nVals < 1) || (nIdx != symDim) || ! isVarEqu)))
+    error ("%s: sym must be in sparse rgdx form", funcName);
+  nRec = nrows(val);
+  p = REAL(val);
+
+  nCols = nIdx + nVals;         /* index and value columns */
+  if (! isPar && wantTe)
+    nCols++;                    /* .te column */
+  if (length(colNames) != nCols)
+    error ("%s: expected %d column names, got %d", funcName, nCols,
+           length(colNames));
+
+  PROTECT(df = allocVector(VECSXP, nCols));
+  for (kCol = 0;  kCol < nIdx;  kCol++) {
+    SET_VECTOR_ELT(df, kCol,
+                   mkFactor (p, nRec, kCol, VECTOR_ELT(uels, kCol)));
+  }
+  for (kCol = nIdx;  kCol < nIdx + nVals;  kCol++) {
+    PROTECT(col = allocVector(REALSXP, nRec));
+    MEMCPY (REAL(col), p + (size_t)kCol * nRec, sizeof(*p) * nRec);
+    SET_VECTOR_ELT(df, kCol, col);
+    UNPROTECT(1);
+  }
+  if (! isPar && wantTe) {
+    SET_VECTOR_ELT(df, symDim, symElt(sym, "te"));
+  }
+  setAttrib(df, R_NamesSymbol, colNames);
+
+  /* compact row names, as data.frame() makes them */
+  if (nRec > 0) {
+    PROTECT(rowNames = allocVector(INTSXP, 2));
+    INTEGER(rowNames)[0] = NA_INTEGER;
+    INTEGER(rowNames)[1] = -nRec;
+  }
+  else
+    PROTECT(rowNames = allocVector(INTSXP, 0));
+  setAttrib(df, R_RowNamesSymbol, rowNames);
+  UNPROTECT(1);
+  setAttrib(df, R_ClassSymbol, mkString("data.frame"));
+
+  setAttrib(df, install("symName"), symElt(sym, "name"));
+  setAttrib(df, install("domains"), symElt(sym, "domains"));
+  domInfo = symElt(sym, "domInfo");
+  if (STRSXP == TYPEOF(domInfo))
+    setAttrib(df, install("domInfo"), domInfo);
+  if (wantTs)
+    setAttrib(df, install("ts"), symElt(sym, "ts"));
+  UNPROTECT(1);
+  return df;
+} /* symToDF */
@@ -0,0 +1,188 @@
+/* uelCache.c
+ * package-level cache of GDX UEL universes, shared across rgdx calls
+ *
+ * Copyright (c) 2010-2021 GAMS Development Corp. <support@gams.com>
+ * Copyright (c) 2010-2021 GAMS Software GmbH <support@gams.com>
+ *
+ * This program and the accompanying materials are made available
+ * under the terms of the Eclipse Public License 2.0 which is
+ * available at  http://www.eclipse.org/legal/epl-2.0.
+ *
+ * This Source Code may also be made available under the following
+ * Secondary Licenses when the conditions for such availability set
+ * forth in the Eclipse Public License, v. 2.0 are satisfied:
+ * GNU General Public License, version 2 or later
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR GPL-2.0-or-later
+ */
+
+#include <R.h>
+#include <Rinternals.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "gdxcc.h"
+#include "gclgms.h"
+#include "globals.h"
+
+#define UELCACHE_MAXENT 8       /* max number of universes kept */
+#define UELCACHE_DEFMB  128     /* default for options(gdx.uelCacheMB) */
+#define UELCACHE_CHAROVH 56     /* estimated bytes per CHARSXP beyond its chars */
+
+typedef struct fileId {         /* identifies one version of a GDX file */
+  shortStringBuf_t path;
+  double size;
+  double mtime;
+  double mtimeNs;               /* sub-second part of mtime, if known */
+  double dev;
+  double ino;
+} fileId_t;
+
+typedef struct uelCacheEnt {
+  fileId_t id;
+  SEXP universe;                /* R_PreserveObject'ed while cached */
+  double bytes;                 /* estimated memory held by universe */
+  unsigned long lastUse;
+} uelCacheEnt_t;
+
+static uelCacheEnt_t uelCache[UELCACHE_MAXENT];
+static unsigned long uelCacheClock = 0;
+
+/* getBudget: return the cache budget in bytes from options(gdx.uelCacheMB) */
+static double
+getBudget (void)
+{
+  SEXP o;
+  double mb = UELCACHE_DEFMB;
+
+  o = GetOption1(install("gdx.uelCacheMB"));
+  if (R_NilValue != o) {
+    mb = asReal(o);
+    if (ISNAN(mb) || mb < 0)
+      mb = UELCACHE_DEFMB;
+  }
+  return mb * 1024 * 1024;
+} /* getBudget */
+
+static void
+dropEnt (uelCacheEnt_t *ent)
+{
+  R_ReleaseObject (ent->universe);
+  memset (ent, 0, sizeof(*ent));
+} /* dropEnt */
+
+/* mkFileId: return a RAWSXP identifying the current version of the file
+ * gdxFileName, or R_NilValue if the file cannot be stat'ed
+ * Call this right after opening the file so it describes what was opened.
+ * File systems with coarse timestamps can still give a rewritten file
+ * the same id, so getUniverse checks a cached universe against the file.
+ */
+SEXP
+mkFileId (const char *gdxFileName)
+{
+  struct stat statBuf;
+  fileId_t *id;
+  SEXP fileId;
+
+  if (stat (gdxFileName, &statBuf))
+    return R_NilValue;
+  fileId = allocVector(RAWSXP, sizeof(*id));
+  id = (fileId_t *) RAW(fileId);
+  memset (id, 0, sizeof(*id));
+  (void) CHAR2ShortStr (gdxFileName, id->path);
+  id->size = (double) statBuf.st_size;
+  id->mtime = (double) statBuf.st_mtime;
+  /* a rewrite within the same second must give a new id too */
+#if defined(__APPLE__)
+  id->mtimeNs = (double) statBuf.st_mtimespec.tv_nsec;
+#elif ! defined(_WIN32)
+  id->mtimeNs = (double) statBuf.st_mtim.tv_nsec;
+#endif
+  id->dev = (double) statBuf.st_dev;
+  id->ino = (double) statBuf.st_ino;
+  return fileId;
+} /* mkFileId */
+
+/* uelCacheGet: return the cached universe for the file version fileId,
+ * or R_NilValue if there is none
+ */
+SEXP
+uelCacheGet (SEXP fileId)
+{
+  int i;
+
+  if (R_NilValue == fileId)
+    return R_NilValue;
+  for (i = 0;  i < UELCACHE_MAXENT;  i++) {
+    if (uelCache[i].universe &&
+        0 == memcmp (&uelCache[i].id, RAW(fileId), sizeof(fileId_t))) {
+      uelCache[i].lastUse = ++uelCacheClock;
+      return uelCache[i].universe;
+    }
+  }
+  return R_NilValue;
+} /* uelCacheGet */
+
+/* uelCachePut: add the universe for the file version fileId to the cache,
+ * evicting least-recently used universes to stay within budget
+ */
+void
+uelCachePut (SEXP fileId, SEXP universe)
+{
+  const fileId_t *id;
+  double budget, bytes, total;
+  int i, k, lru, n;
+
+  if (R_NilValue == fileId)
+    return;
+  id = (const fileId_t *) RAW(fileId);
+  budget = getBudget ();
+  n = length(universe);
+  bytes = (double) n * (sizeof(SEXP) + UELCACHE_CHAROVH);
+  for (k = 0;  k < n;  k++)
+    bytes += LENGTH(STRING_ELT(universe, k));
+
+  /* drop older versions of this file and, if the budget shrank, everything
+   * that no longer fits */
+  for (total = 0, i = 0;  i < UELCACHE_MAXENT;  i++) {
+    if (! uelCache[i].universe)
+      continue;
+    if (0 == strcmp(uelCache[i].id.path, id->path))
+      dropEnt (uelCache + i);
+    else
+      total += uelCache[i].bytes;
+  }
+  if (bytes > budget) {
+    for (i = 0;  i < UELCACHE_MAXENT;  i++) {
+      if (uelCache[i].universe && total > budget) {
+        total -= uelCache[i].bytes;
+        dropEnt (uelCache + i);
+      }
+    }
+    return;
+  }
+
+  /* evict least-recently used universes until the new one fits */
+  for (;;) {
+    for (k = -1, lru = -1, i = 0;  i < UELCACHE_MAXENT;  i++) {
+      if (! uelCache[i].universe) {
+        if (k < 0)
+          k = i;
+      }
+      else if (lru < 0 || uelCache[i].lastUse < uelCache[lru].lastUse)
+        lru = i;
+    }
+    if (k >= 0 && total + bytes <= budget)
+      break;
+    total -= uelCache[lru].bytes;
+    dropEnt (uelCache + lru);
+  }
+
+  R_PreserveObject (universe);
+  MEMCPY (&uelCache[k].id, id, sizeof(*id));
+  uelCache[k].universe = universe;
+  uelCache[k].bytes = bytes;
+  uelCache[k].lastUse = ++uelCacheClock;
+} /* uelCachePut */
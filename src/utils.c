@@ -137,11 +137,40 @@ checkStringLength (const char *str)
   }
 } /* checkStringLength */
 
+/* uelString: return the name of UEL k (one-based) of the GDX file open
+ * in gdxHandle, taken from the universe uni if that has been built
+ * (i.e. is not R_NilValue) and fetched from GDX into buf o/w
+ */
+const char *
+uelString (SEXP uni, int k, shortStringBuf_t buf)
+{
+  int UELUserMapping;
+
+  if (R_NilValue != uni)
+    return CHAR(STRING_ELT(uni, k-1));
+  if (!gdxUMUelGet (gdxHandle, k, buf, &UELUserMapping)) {
+    error("Could not gdxUMUelGet");
+  }
+  return buf;
+} /* uelString */
+
+/* uelCHARSXP: return UEL k as a CHARSXP, as with uelString */
+SEXP
+uelCHARSXP (SEXP uni, int k)
+{
+  shortStringBuf_t buf;
+
+  if (R_NilValue != uni)
+    return STRING_ELT(uni, k-1);
+  return mkChar(uelString (uni, k, buf));
+} /* uelCHARSXP */
+
 /* compressData: compress the $vals data (in sparse form)
  * and also the associated domains.
  *     in: symDim - symbol dimension
  *     in: mRows - nonzeros in symbol / rows in $vals
  *     in: uni, nUni - universe of uels and its size/count
+ *         uni may be R_NilValue if the universe has not been built
  *     in: xpFilter_t filterList[]
  * in/out: spVals - $vals to output
  *    out: uelList - $uels to output
@@ -153,7 +182,8 @@ compressData (int symDim, int mRows, SEXP uni, int nUni, xpFilter_t filterList[]
   int n;                  /* initial cardinality for this index pos */
   int nn;                 /* compressed cardinality */
   int nMax;
-  int iDim, i, k, stop, nTmp;
+  int iDim, i, nTmp;
+  R_xlen_t k, stop;             /* offsets into spVals, may be a long vector */
   int *mask;
   double *v;                    /* index values in spVals */
   SEXP uelVec;                  /* elements of uelList */
@@ -195,7 +225,7 @@ compressData (int symDim, int mRows, SEXP uni, int nUni, xpFilter_t filterList[]
       /* record and count used index values */
       /* (void) memset (mask, 0, nMax*sizeof(*mask)); */
       (void) memset (mask, 0, n*sizeof(*mask));
-      for (k = mRows*iDim, stop = mRows*(iDim+1);  k < stop;  k++) {
+      for (k = (R_xlen_t)mRows*iDim, stop = (R_xlen_t)mRows*(iDim+1);  k < stop;  k++) {
         i = (int)v[k];          /* one-based */
         if ((i <= 0) || (i > n))
           error ("bogus index i found in compressData: iDim=%d n=%d i=%d",
@@ -212,13 +242,13 @@ compressData (int symDim, int mRows, SEXP uni, int nUni, xpFilter_t filterList[]
       /* loop over found index values in mask, computing new index values */
       for (nTmp = 0, i = 0;  i < n;  i++) {
         if (mask[i]) {
-          SET_STRING_ELT(uelVec, nTmp, STRING_ELT(uni, i));
+          SET_STRING_ELT(uelVec, nTmp, uelCHARSXP(uni, i+1));
           nTmp++;
           mask[i] = nTmp;
         }
       }
       /*  update index values to compressed ordering */
-      for (k = mRows*iDim, stop = mRows*(iDim+1);  k < stop;  k++) {
+      for (k = (R_xlen_t)mRows*iDim, stop = (R_xlen_t)mRows*(iDim+1);  k < stop;  k++) {
         i = (int)v[k] - 1;
         v[k] = mask[i];
       } /* loop over index values in this position */
@@ -228,7 +258,7 @@ compressData (int symDim, int mRows, SEXP uni, int nUni, xpFilter_t filterList[]
       /* record and count used index values */
       /* (void) memset (mask, 0, nMax*sizeof(*mask)); */
       (void) memset (mask, 0, n*sizeof(*mask));
-      for (k = mRows*iDim, stop = mRows*(iDim+1);  k < stop;  k++) {
+      for (k = (R_xlen_t)mRows*iDim, stop = (R_xlen_t)mRows*(iDim+1);  k < stop;  k++) {
         i = (int)v[k];          /* one-based */
         if ((i <= 0) || (i > n))
           error ("bogus index i found in compressData: iDim=%d n=%d i=%d",
@@ -246,13 +276,13 @@ compressData (int symDim, int mRows, SEXP uni, int nUni, xpFilter_t filterList[]
        * computing new index values and new output uels */
       for (nTmp = 0, i = 0;  i < n;  i++) {
         if (mask[i]) {
-          SET_STRING_ELT(uelVec, nTmp, STRING_ELT(uni, xpf->idx[i]-1));
+          SET_STRING_ELT(uelVec, nTmp, uelCHARSXP(uni, xpf->idx[i]));
           nTmp++;
           mask[i] = nTmp;
         }
       }
       /*  update index values to compressed ordering */
-      for (k = mRows*iDim, stop = mRows*(iDim+1);  k < stop;  k++) {
+      for (k = (R_xlen_t)mRows*iDim, stop = (R_xlen_t)mRows*(iDim+1);  k < stop;  k++) {
         i = (int)v[k] - 1;
         v[k] = mask[i];
       } /* loop over index values in this position */
@@ -275,11 +305,12 @@ void
 createElementMatrix (SEXP compVal, SEXP textElement, SEXP compTe,
                      SEXP compUels, int symDim, int nRec)
 {
-  int i, j, iRec, index, totNumber;
+  int i, iRec;
+  R_xlen_t j, index, totNumber;
   double *p;
 
   /* Step 1: loop over full matrix and set every value as empty string */
-  for (j = 0; j < length(compTe); j++) {
+  for (j = 0; j < xlength(compTe); j++) {
     SET_STRING_ELT(compTe, j, mkChar(""));
   }
 
@@ -290,7 +321,7 @@ createElementMatrix (SEXP compVal, SEXP textElement, SEXP compTe,
     index = 0;
     totNumber = 1;
     for (i = 0;  i < symDim;  i++) {
-      index = index + ((int)p[iRec + nRec*i] - 1)*totNumber;
+      index = index + ((R_xlen_t)p[iRec + (R_xlen_t)nRec*i] - 1)*totNumber;
       totNumber = (totNumber)*length(VECTOR_ELT(compUels, i));
     }
     SET_STRING_ELT(compTe, index, duplicate(STRING_ELT(textElement, iRec)) );
@@ -299,6 +330,76 @@ createElementMatrix (SEXP compVal, SEXP textElement, SEXP compTe,
   return;
 } /* createElementMatrix */
 
+/* domain sets at least this large get a uel lookup table in their xpFilter:
+ * for smaller ones, scanning is about as quick */
+#define XPF_LOOKUP_MIN 64
+
+/* hashUel: hash a uel index into a table with mask+1 slots */
+#define hashUel(uel,mask) ((int)(((unsigned int)(uel) * 2654435761u) & (mask)))
+
+/* mkUelLookup: build a table mapping the n uel indices in idx
+ * to their (one-based) position in idx in constant time
+ * If the uel indices are dense enough the table is indexed directly
+ * by uel, o/w it is an open-addressing hash table holding
+ * 1 + the position in idx (0 for an empty slot).
+ */
+static void
+mkUelLookup (const int idx[], int n, uelLookup_t *lu)
+{
+  int k, h, mask, maxUel, uel;
+  int *pos;
+
+  for (maxUel = 0, k = 0;  k < n;  k++) {
+    if (idx[k] > maxUel)
+      maxUel = idx[k];
+  }
+  lu->isDense = (maxUel <= 16 * n + 1024);
+  if (lu->isDense)
+    lu->posLen = maxUel + 1;
+  else {
+    for (lu->posLen = 1024;  lu->posLen < 2 * n;  lu->posLen *= 2)
+      ;
+  }
+  lu->pos = pos = calloc(lu->posLen, sizeof(*pos));
+  if (NULL == pos)
+    error ("memory exhaustion error: could not allocate uel lookup table");
+  mask = lu->posLen - 1;
+  for (k = 0;  k < n;  k++) {
+    uel = idx[k];
+    if (uel <= 0)
+      continue;                 /* not in GDX: never matches */
+    if (lu->isDense) {
+      if (0 == pos[uel])        /* keep the first of any duplicates */
+        pos[uel] = k + 1;
+      continue;
+    }
+    for (h = hashUel(uel,mask);  pos[h];  h = (h+1) & mask) {
+      if (idx[pos[h]-1] == uel)
+        break;
+    }
+    if (0 == pos[h])
+      pos[h] = k + 1;
+  }
+} /* mkUelLookup */
+
+/* findUel: return 1 + the position of uel in idx, 0 if not found,
+ * using the table built by mkUelLookup
+ */
+static int
+findUel (const int idx[], const uelLookup_t *lu, int uel)
+{
+  int k, mask;
+
+  if (lu->isDense)
+    return (uel < lu->posLen) ? lu->pos[uel] : 0;
+  mask = lu->posLen - 1;
+  for (k = hashUel(uel,mask);  lu->pos[k];  k = (k+1) & mask) {
+    if (idx[lu->pos[k]-1] == uel)
+      return lu->pos[k];
+  }
+  return 0;
+} /* findUel */
+
 /* mkHPFilter: construct an integer filter from the user-supplied string uels
  * ufilter: user-supplied filter - $uels[k]
  * hpf: high-performance filter for internal use
@@ -318,7 +419,8 @@ mkHPFilter (SEXP uFilter, hpFilter_t *hpf)
   hpf->n = n = length(uFilter);
   /* Rprintf ("  mkHPFilter: n = %d\n", n); */
   hpf->prevPos = 0;
-  hpf->idx = idx =  malloc(n * sizeof(*idx));
+  /* at least one element: malloc(0) may return NULL for an empty filter */
+  hpf->idx = idx =  malloc((n > 0 ? n : 1) * sizeof(*idx));
   if (NULL == idx)
     error ("memory exhaustion error: could not allocate index for hpFilter");
   for (lastUelInt = 0, k = 0;  k < n;  k++) {
@@ -342,27 +444,69 @@ mkHPFilter (SEXP uFilter, hpFilter_t *hpf)
     checkForDuplicates (uFilter);
   }
   /* Rprintf ("  mkHPFilter: isOrdered = %d  allFound = %d\n", isOrdered, allFound); */
+  mkUelLookup (idx, n, &hpf->lookup);
   return;
 } /* mkHPFilter */
 
+/* getDomainSetIdx: return the UEL indices of the one-dimensional set kSym
+ * in a malloc'ed array, for use in an xpFilter
+ * The indices are read from GDX only once per open file and kept in
+ * fileCache, so symbols sharing a domain set share the read.
+ */
+static int *
+getDomainSetIdx (int kSym, int *nRecs, SEXP fileCache)
+{
+  SEXP domSets, setIdx;
+  int iRec, n, changeIdx, nSyms, nUels;
+  int *idx, *p;
+  gdxUelIndex_t uels;
+  gdxValues_t values;
+
+  domSets = VECTOR_ELT(fileCache, FCACHE_DOMSETS);
+  if (R_NilValue == domSets) {
+    (void) gdxSystemInfo (gdxHandle, &nSyms, &nUels);
+    domSets = allocVector(VECSXP, nSyms+1);
+    SET_VECTOR_ELT(fileCache, FCACHE_DOMSETS, domSets);
+  }
+  setIdx = VECTOR_ELT(domSets, kSym);
+  if (R_NilValue == setIdx) {
+    gdxDataReadRawStart (gdxHandle, kSym, &n);
+    PROTECT(setIdx = allocVector(INTSXP, n));
+    p = INTEGER(setIdx);
+    for (iRec = 0;  iRec < n;  iRec++) {
+      gdxDataReadRaw (gdxHandle, uels, values, &changeIdx);
+      p[iRec] = uels[0];
+    } /* loop over GDX records */
+    if (!gdxDataReadDone (gdxHandle)) {
+      error ("Could not gdxDataReadDone");
+    }
+    SET_VECTOR_ELT(domSets, kSym, setIdx);
+    UNPROTECT(1);
+  }
+  n = length(setIdx);
+  idx = malloc(n * sizeof(*idx));
+  if (n > 0)
+    MEMCPY (idx, INTEGER(setIdx), n * sizeof(*idx));
+  *nRecs = n;
+  return idx;
+} /* getDomainSetIdx */
+
 /* mkXPFilters: construct XPfilter from what?
  * symIdx: of symbol to construct filter for
  * xpf: high-performance filter for internal use
+ * fileCache: per-file cache holding the domain sets already read
  */
 void
 mkXPFilter (int symIdx, Rboolean useDomInfo, xpFilter_t filterList[],
-            SEXP outDomains, int *domInfoCode)
+            SEXP outDomains, int *domInfoCode, SEXP fileCache)
 {
-  int rc, iRec, nRecs, changeIdx;
+  int rc, nRecs;
   int kSym, kDim, kType;        /* for loop over index sets */
   int iDim, symDim, symType, symNNZ, symUser;
-  int *idx;
   shortStringBuf_t symName, kName, symText;
   gdxStrIndex_t domNames;
   gdxStrIndexPtrs_t domPtrs;
   gdxUelIndex_t symDoms;
-  gdxUelIndex_t uels;
-  gdxValues_t values;
   xpFilter_t *xpf;
 
   GDXSTRINDEXPTRS_INIT (domNames, domPtrs);
@@ -434,16 +578,10 @@ mkXPFilter (int symIdx, Rboolean useDomInfo, xpFilter_t filterList[],
         xpf->domType = relaxed;
         xpf->fType = integer;
         xpf->prevPos = 0;
-        gdxDataReadRawStart (gdxHandle, kSym, &nRecs);
+        xpf->idx = getDomainSetIdx (kSym, &nRecs, fileCache);
         xpf->n = nRecs;
-        xpf->idx = idx =  malloc(nRecs * sizeof(*idx));
-        for (iRec = 0;  iRec < nRecs;  iRec++) {
-          gdxDataReadRaw (gdxHandle, uels, values, &changeIdx);
-          idx[iRec] = uels[0];
-        } /* loop over GDX records */
-        if (!gdxDataReadDone (gdxHandle)) {
-          error ("Could not gdxDataReadDone");
-        }
+        if (nRecs >= XPF_LOOKUP_MIN)
+          mkUelLookup (xpf->idx, nRecs, &xpf->lookup);
       } /* end loop over dims */
       break;
     case 3:                   /* full domain info */
@@ -469,16 +607,10 @@ mkXPFilter (int symIdx, Rboolean useDomInfo, xpFilter_t filterList[],
         xpf->domType = regular;
         xpf->fType = integer;
         xpf->prevPos = 0;
-        gdxDataReadRawStart (gdxHandle, kSym, &nRecs);
+        xpf->idx = getDomainSetIdx (kSym, &nRecs, fileCache);
         xpf->n = nRecs;
-        xpf->idx = idx =  malloc(nRecs * sizeof(*idx));
-        for (iRec = 0;  iRec < nRecs;  iRec++) {
-          gdxDataReadRaw (gdxHandle, uels, values, &changeIdx);
-          idx[iRec] = uels[0];
-        } /* loop over GDX records */
-        if (!gdxDataReadDone (gdxHandle)) {
-          error ("Could not gdxDataReadDone");
-        }
+        if (nRecs >= XPF_LOOKUP_MIN)
+          mkUelLookup (xpf->idx, nRecs, &xpf->lookup);
       } /* loop over domain sets */
       break;
     case 0:                   /* bad input */
@@ -537,7 +669,7 @@ int
 findInHPFilter (int symDim, const int inUels[], hpFilter_t filterList[],
                 int outIdx[])
 {
-  int iDim, k, targetUel, found, isOrdered;
+  int iDim, targetUel, found;
   const int *idx;
   hpFilter_t *hpf;
 
@@ -554,46 +686,19 @@ findInHPFilter (int symDim, const int inUels[], hpFilter_t filterList[],
       break;
     case integer:
       idx = hpf->idx;
-      isOrdered = hpf->isOrdered;
       targetUel = inUels[iDim];
-      found = 0;
-      if (isOrdered) {
-        /* search starting with previous found position */
-        for (k = hpf->prevPos;  k < hpf->n;  k++) {
-          if (idx[k] == targetUel) {
-            hpf->prevPos = k;
-            outIdx[iDim] = k + 1;
-            found = 1;
-            break;
-          }
-          else if (idx[k] > targetUel)
-            break;
-        } /* loop over filter elements */
-        if (! found) {          /* search from the beginning */
-          for (k = 0;  k < hpf->n;  k++) {
-            if (idx[k] == targetUel) {
-              hpf->prevPos = k;
-              outIdx[iDim] = k + 1;
-              found = 1;
-              break;
-            }
-            else if (idx[k] > targetUel)
-              break;
-          } /* loop over filter elements */
-        }
-      } /* if (isOrdered) */
-      else {
-        for (k = 0;  k < hpf->n;  k++) {
-          if (idx[k] == targetUel) {
-            hpf->prevPos = k;
-            outIdx[iDim] = k + 1;
-            found = 1;
-            break;
-          }
-        } /* loop over filter elements */
-      } /* if (isOrdered) .. else .. */
+      /* ordered data usually hits the previous position again:
+       * an empty filter has no previous position to look at */
+      if (hpf->isOrdered && (hpf->n > 0) &&
+          (idx[hpf->prevPos] == targetUel)) {
+        outIdx[iDim] = hpf->prevPos + 1;
+        break;
+      }
+      found = findUel (idx, &hpf->lookup, targetUel);
       if (! found)
         return 0;
+      hpf->prevPos = found - 1;
+      outIdx[iDim] = found;
       break;
     default:
       error ("internal error: unknown hpFilter type");
@@ -657,6 +762,18 @@ findInXPFilter (int symDim, const int inUels[], xpFilter_t filterList[],
           outIdx[iDim] = xpf->prevPos + 1;
           break;                /* from switch */
         }
+      }
+      if (xpf->lookup.pos) {
+        /* large domain: no scanning */
+        reset = 1;
+        k = findUel (idx, &xpf->lookup, targetUel);
+        if (! k)
+          return iDim + 1;      /* not found??  bad! */
+        xpf->prevPos = k - 1;
+        outIdx[iDim] = k;
+        break;                  /* from switch stmt */
+      }
+      if (! reset) {
         reset = 1;
         /* search starting one past the previous found position */
         for (k = xpf->prevPos + 1, stop = xpf->n;  k < stop;  k++) {
@@ -841,42 +958,6 @@ char *getGlobalString (const char *globName, shortStringBuf_t result)
   return res;
 } /* getGlobalString */
 
-/* getNonDefaultElemCount
- * return count of non-default elements for the specified field
- * of the symbol referenced by symIdx
- */
-int
-getNonDefaultElemCount (gdxHandle_t h, int symIdx,
-                        int symType, int symSubType, dField_t dField)
-{
-  double defVal;                /* default value - may be nonzero */
-  int nRecs, changeIdx, i, cnt;
-  gdxUelIndex_t uels;
-  gdxValues_t values;
-
-  defVal = 0;
-  switch (symType) {
-  case GMS_DT_VAR:
-    defVal = getDefValVar (symSubType, dField);
-    break;
-  case GMS_DT_EQU:
-    defVal = getDefValEqu (symSubType, dField);
-    break;
-  } /* end switch */
-
-  gdxDataReadRawStart (h, symIdx, &nRecs);
-  if (all == dField) {
-    return nRecs;
-  }
-  for (cnt = 0, i = 0;  i < nRecs;  i++) {
-    gdxDataReadRaw (h, uels, values, &changeIdx);
-    if (values[dField] != defVal) {
-      cnt++;
-    }
-  }
-  return cnt;
-} /* getNonDefaultElemCount */
-
 /* getNonZeroElements
  * return nonzero count for the specified field of a variable or equation
  */
@@ -913,6 +994,25 @@ getInventSetText (Rboolean defVal)
   return asLogical(o);
 } /* getInventSetText */
 
+/* get option gdx.readEngine: "raw" (the default), "filtered" or "fast" */
+readEngine_t
+getReadEngine (void)
+{
+  SEXP o = GetOption1(install("gdx.readEngine"));
+  const char *s;
+
+  if ((R_NilValue == o) || (STRSXP != TYPEOF(o)) || (length(o) < 1))
+    return rawEngine;
+  s = CHAR(STRING_ELT(o, 0));
+  if (0 == strcmp("filtered", s))
+    return filteredEngine;
+  if (0 == strcmp("fast", s))
+    return fastEngine;
+  if (0 != strcmp("raw", s))
+    error ("options(gdx.readEngine='%s') not recognized: use 'raw', 'filtered' or 'fast'", s);
+  return rawEngine;
+} /* getReadEngine */
+
 /* interpret an expression (probably an input arg) as a logical/boolean */
 Rboolean
 exp2Boolean (SEXP exp)
@@ -1073,6 +1173,50 @@ loadGDX (void)
   return;
 } /* loadGDX */
 
+/* openGDXRead: open the GDX file for reading in gdxHandle,
+ * and set up the special values as rgdx wants them
+ * raise an exception on failure
+ */
+void
+openGDXRead (shortStringBuf_t gdxFileName)
+{
+  FILE *fin;
+  gdxSVals_t sVals;
+  d64_t d64;
+  shortStringBuf_t msgBuf;
+  double dt, posInf, negInf;
+  int rc, errNum;
+
+  /* ------------------- check if the GDX file exists --------------- */
+  checkFileExtension (gdxFileName);
+  fin = fopen (gdxFileName, "r");
+  if (fin==NULL) {
+    error ("GDX file '%s' not found", gdxFileName);
+  }
+  fclose(fin);
+
+  loadGDX();
+  rc = gdxCreate (&gdxHandle, msgBuf, sizeof(msgBuf));
+  if (0 == rc)
+    error ("Error creating GDX object: %s", msgBuf);
+  rc = gdxOpenRead (gdxHandle, gdxFileName, &errNum);
+  if (errNum || 0 == rc) {
+    error("Could not open gdx file with gdxOpenRead");
+  }
+
+  gdxGetSpecialValues (gdxHandle, sVals);
+  d64.u64 = 0x7fffffffffffffff; /* positive QNaN, mantissa all on */
+  sVals[GMS_SVIDX_UNDEF] = d64.x;
+  sVals[GMS_SVIDX_NA] = NA_REAL;
+  dt = 0.0;
+  posInf =  1 / dt;
+  negInf = -1 / dt;
+  sVals[GMS_SVIDX_EPS] = 0;
+  sVals[GMS_SVIDX_PINF] = posInf;
+  sVals[GMS_SVIDX_MINF] = negInf;
+  gdxSetSpecialValues (gdxHandle, sVals);
+} /* openGDXRead */
+
 /* makeStrVec
  * converts the input vector of ints or reals into strings
  * both inExp and outExp are assumed to be allocated on input
@@ -1112,29 +1256,59 @@ makeStrVec (SEXP outExp, SEXP inExp)
   return;
 } /* makeStrVec */
 
+/* wideToFull: plug the nRec records of the sparse $val p in the wide
+ * layout (symDim index columns, then nFields value columns) into pFull,
+ * which holds nFields blocks of fullCard values, one block per field
+ */
+static void
+wideToFull (const double *p, int nRec, int symDim, const int card[],
+            R_xlen_t fullCard, int nFields, double *pFull)
+{
+  R_xlen_t index, ii;
+  int iRec, k;
+
+  for (iRec = 0;  iRec < nRec;  iRec++) {
+    ii = iRec + (R_xlen_t)nRec*(symDim-1);
+    for (index = p[ii]-1, k = symDim-2;  k >= 0;  k--) {
+      ii -= nRec;
+      index = (index * card[k]) + p[ii] - 1;
+    }
+    ii = iRec + (R_xlen_t)nRec*symDim;
+    for (k = 0;  k < nFields;  k++) {
+      pFull[index + k*fullCard] = p[ii];
+      ii += nRec;
+    }
+  }
+} /* wideToFull */
+
 /* sparseToFull: from input data in sparse form, create output data in full form
  * spVal: input .val matrix in sparse form
  * fullVal: output .val matrix in full form
  * uelLists: .uels for symbol
+ * fields: the fields in spVal if dField == all
+ * wide: with dField == all, spVal has one row per record and a value
+ *   column per field (layout='wide') instead of a row per field
  * N.B.: R stores matrices column-wise, i.e. left index moving fastest
  */
 void
 sparseToFull (SEXP spVal, SEXP fullVal, SEXP uelLists,
-              int symType, int symSubType, dField_t dField, int nRec, int symDimX)
+              int symType, int symSubType, dField_t dField,
+              const fieldSet_t *fields, Rboolean wide, int nRec, int symDimX)
 {
   int k, iRec;
-  int fullLen;             /* length of output matrix fullVal */
-  int fullCard;            /* cardinality of fully allocated matrix */
+  R_xlen_t kk;
+  R_xlen_t fullLen;        /* length of output matrix fullVal */
+  R_xlen_t fullCard;       /* cardinality of fully allocated matrix */
   int card[GLOBAL_MAX_INDEX_DIM];
   double defVal;           /* default value - may be nonzero */
   double *p, *pFull, *tFull;
-  int index;
+  R_xlen_t index;          /* 64-bit offsets: fullVal may be a long vector */
   int symDim = symDimX;
-  int ii;
+  R_xlen_t ii;
   dField_t iField;
 
   pFull = REAL(fullVal);
-  fullLen = length(fullVal);
+  fullLen = xlength(fullVal);
   p = REAL(spVal);
 
   switch (symType) {
@@ -1152,7 +1326,7 @@ sparseToFull (SEXP spVal, SEXP fullVal, SEXP uelLists,
              fullCard, fullLen);
 
     for (iRec = 0;  iRec < nRec;  iRec++) {
-      ii = iRec + nRec*(symDim-1);
+      ii = iRec + (R_xlen_t)nRec*(symDim-1);
       for (index = p[ii]-1, k = symDim-2;  k >= 0;  k--) {
         ii -= nRec;
         index = (index * card[k]) + p[ii] - 1;
@@ -1174,12 +1348,12 @@ sparseToFull (SEXP spVal, SEXP fullVal, SEXP uelLists,
              fullCard, fullLen);
 
     for (iRec = 0;  iRec < nRec;  iRec++) {
-      ii = iRec + nRec*(symDim-1);
+      ii = iRec + (R_xlen_t)nRec*(symDim-1);
       for (index = p[ii]-1, k = symDim-2;  k >= 0;  k--) {
         ii -= nRec;
         index = (index * card[k]) + p[ii] - 1;
       }
-      pFull[index] = p[iRec + nRec*symDim];
+      pFull[index] = p[iRec + (R_xlen_t)nRec*symDim];
     } /* end loop over nonzeros */
     break;
   case GMS_DT_VAR:
@@ -1192,29 +1366,34 @@ sparseToFull (SEXP spVal, SEXP fullVal, SEXP uelLists,
         card[k] = length(VECTOR_ELT(uelLists, k)); /* number of elements in dim k */
         fullCard *= card[k];
       }
-      if ((fullCard * 5) != fullLen)
-        error ("sparseToFull: unexpected inputs:  fullCard*5=%d  fullLen=%d",
-               fullCard*5, fullLen);
+      if ((fullCard * fields->n) != fullLen)
+        error ("sparseToFull: unexpected inputs:  fullCard*%d=%.0f  fullLen=%.0f",
+               fields->n, (double) fullCard*fields->n, (double) fullLen);
 
-      /* step 1: initialize full matrix to the defaults */
+      /* step 1: initialize full matrix to the defaults, one block per field */
       getDefRecVar (symSubType, defRec);
-      for (tFull = pFull, iField = level;  iField <= scale;  iField++) {
+      for (tFull = pFull, k = 0;  k < fields->n;  k++) {
+        iField = (dField_t) fields->idx[k];
         if (0 == defRec[iField])
           (void) memset (tFull, 0, fullCard * sizeof(*pFull));
         else {
-          for (k = 0;  k < fullCard;  k++)
-            tFull[k] = defRec[iField];
+          for (kk = 0;  kk < fullCard;  kk++)
+            tFull[kk] = defRec[iField];
         }
         tFull += fullCard;
       }
       /* step 2: loop over each record of the variable to plug in non-defaults */
+      if (wide) {
+        wideToFull (p, nRec, symDim, card, fullCard, fields->n, pFull);
+        break;
+      }
       for (iRec = 0;  iRec < nRec;  iRec++) {
-        ii = iRec + nRec*symDim;
+        ii = iRec + (R_xlen_t)nRec*symDim;
         for (index = p[ii]-1, k = symDim-1;  k >= 0;  k--) {
           ii -= nRec;
           index = (index * card[k]) + p[ii] - 1;
         }
-        pFull[index] = p[iRec + nRec*symDimX];
+        pFull[index] = p[iRec + (R_xlen_t)nRec*symDimX];
       } /* end loop over nonzeros */
     }
     else {                      /* all != dField */
@@ -1224,8 +1403,8 @@ sparseToFull (SEXP spVal, SEXP fullVal, SEXP uelLists,
         (void) memset (pFull, 0, fullLen * sizeof(*pFull));
       }
       else {
-        for (k = 0;  k < fullLen;  k++)
-          pFull[k] = defVal;
+        for (kk = 0;  kk < fullLen;  kk++)
+          pFull[kk] = defVal;
       }
       /* step 2: loop over each row/nonzero of sparse matrix to populate full matrix */
       fullCard = 1;
@@ -1234,16 +1413,16 @@ sparseToFull (SEXP spVal, SEXP fullVal, SEXP uelLists,
         fullCard *= card[k];
       }
       if (fullCard != fullLen)
-        error ("sparseToFull: unexpected inputs:  fullCard=%d  fullLen=%d",
-               fullCard, fullLen);
+        error ("sparseToFull: unexpected inputs:  fullCard=%.0f  fullLen=%.0f",
+               (double) fullCard, (double) fullLen);
 
       for (iRec = 0;  iRec < nRec;  iRec++) {
-        ii = iRec + nRec*(symDim-1);
+        ii = iRec + (R_xlen_t)nRec*(symDim-1);
         for (index = p[ii]-1, k = symDim-2;  k >= 0;  k--) {
           ii -= nRec;
           index = (index * card[k]) + p[ii] - 1;
         }
-        pFull[index] = p[iRec + nRec*symDim];
+        pFull[index] = p[iRec + (R_xlen_t)nRec*symDim];
       } /* end loop over nonzeros */
     } /* if all == dField .. else .. */
     break;
@@ -1257,29 +1436,34 @@ sparseToFull (SEXP spVal, SEXP fullVal, SEXP uelLists,
         card[k] = length(VECTOR_ELT(uelLists, k)); /* number of elements in dim k */
         fullCard *= card[k];
       }
-      if ((fullCard * 5) != fullLen)
-        error ("sparseToFull: unexpected inputs:  fullCard*5=%d  fullLen=%d",
-               fullCard*5, fullLen);
+      if ((fullCard * fields->n) != fullLen)
+        error ("sparseToFull: unexpected inputs:  fullCard*%d=%.0f  fullLen=%.0f",
+               fields->n, (double) fullCard*fields->n, (double) fullLen);
 
-      /* step 1: initialize full matrix to the defaults */
+      /* step 1: initialize full matrix to the defaults, one block per field */
       getDefRecEqu (symSubType, defRec);
-      for (tFull = pFull, iField = level;  iField <= scale;  iField++) {
+      for (tFull = pFull, k = 0;  k < fields->n;  k++) {
+        iField = (dField_t) fields->idx[k];
         if (0 == defRec[iField])
           (void) memset (tFull, 0, fullCard * sizeof(*pFull));
         else {
-          for (k = 0;  k < fullCard;  k++)
-            tFull[k] = defRec[iField];
+          for (kk = 0;  kk < fullCard;  kk++)
+            tFull[kk] = defRec[iField];
         }
         tFull += fullCard;
       }
       /* step 2: loop over each record of the equation to plug in non-defaults */
+      if (wide) {
+        wideToFull (p, nRec, symDim, card, fullCard, fields->n, pFull);
+        break;
+      }
       for (iRec = 0;  iRec < nRec;  iRec++) {
-        ii = iRec + nRec*symDim;
+        ii = iRec + (R_xlen_t)nRec*symDim;
         for (index = p[ii]-1, k = symDim-1;  k >= 0;  k--) {
           ii -= nRec;
           index = (index * card[k]) + p[ii] - 1;
         }
-        pFull[index] = p[iRec + nRec*symDimX];
+        pFull[index] = p[iRec + (R_xlen_t)nRec*symDimX];
       } /* end loop over nonzeros */
       /* error  ("not yet implemented YY"); */
     }
@@ -1290,8 +1474,8 @@ sparseToFull (SEXP spVal, SEXP fullVal, SEXP uelLists,
         (void) memset (pFull, 0, fullLen * sizeof(*pFull));
       }
       else {
-        for (k = 0;  k < fullLen;  k++)
-          pFull[k] = defVal;
+        for (kk = 0;  kk < fullLen;  kk++)
+          pFull[kk] = defVal;
       }
       /* step 2: loop over each row/nonzero of sparse matrix to populate full matrix */
       fullCard = 1;
@@ -1300,16 +1484,16 @@ sparseToFull (SEXP spVal, SEXP fullVal, SEXP uelLists,
         fullCard *= card[k];
       }
       if (fullCard != fullLen)
-        error ("sparseToFull: unexpected inputs:  fullCard=%d  fullLen=%d",
-               fullCard, fullLen);
+        error ("sparseToFull: unexpected inputs:  fullCard=%.0f  fullLen=%.0f",
+               (double) fullCard, (double) fullLen);
 
       for (iRec = 0;  iRec < nRec;  iRec++) {
-        ii = iRec + nRec*(symDim-1);
+        ii = iRec + (R_xlen_t)nRec*(symDim-1);
         for (index = p[ii]-1, k = symDim-2;  k >= 0;  k--) {
           ii -= nRec;
           index = (index * card[k]) + p[ii] - 1;
         }
-        pFull[index] = p[iRec + nRec*symDim];
+        pFull[index] = p[iRec + (R_xlen_t)nRec*symDim];
       } /* end loop over nonzeros */
     } /* if all == dField .. else .. */
     break;
@@ -1320,6 +1504,76 @@ sparseToFull (SEXP spVal, SEXP fullVal, SEXP uelLists,
   return;
 } /* sparseToFull */
 
+/* sparseAllRows: return the rows of a sparse $val with nFields fields
+ * (e.g. field='all') for nRecs records, i.e. one row per record and field
+ * R matrices are limited to INT_MAX rows, however long the vector
+ */
+int
+sparseAllRows (int nRecs, int nFields)
+{
+  if (nRecs > INT_MAX / nFields)
+    error ("sparse $val with %d fields for %d records exceeds the R limit"
+           " of %d matrix rows: read one field at a time", nFields, nRecs,
+           INT_MAX);
+  return nRecs * nFields;
+} /* sparseAllRows */
+
+/* allFields: set fields to all of them, as for field='all' */
+void
+allFields (fieldSet_t *fields)
+{
+  int k;
+
+  fields->n = GMS_VAL_MAX;
+  for (k = 0;  k < GMS_VAL_MAX;  k++)
+    fields->idx[k] = k;
+} /* allFields */
+
+/* initFullVal: initialize the full-form .val pFull to the default values
+ * fullCard: cardinality of the symbol, i.e. product of the index extents
+ * with dField == all for variables and equations, pFull holds
+ * fields->n blocks of fullCard values, one block per field
+ */
+void
+initFullVal (double *pFull, R_xlen_t fullCard, int symType, int symSubType,
+             dField_t dField, const fieldSet_t *fields)
+{
+  double defRec[GMS_VAL_MAX];
+  double *tFull;
+  dField_t iField;
+  R_xlen_t k;
+  int f;
+
+  if ((GMS_DT_VAR != symType) && (GMS_DT_EQU != symType)) {
+    (void) memset (pFull, 0, fullCard * sizeof(*pFull));
+    return;
+  }
+  if (all != dField) {
+    defRec[0] = getDefVal (symType, symSubType, dField);
+    if (0 == defRec[0])
+      (void) memset (pFull, 0, fullCard * sizeof(*pFull));
+    else {
+      for (k = 0;  k < fullCard;  k++)
+        pFull[k] = defRec[0];
+    }
+    return;
+  }
+  if (GMS_DT_VAR == symType)
+    getDefRecVar (symSubType, defRec);
+  else
+    getDefRecEqu (symSubType, defRec);
+  for (tFull = pFull, f = 0;  f < fields->n;  f++) {
+    iField = (dField_t) fields->idx[f];
+    if (0 == defRec[iField])
+      (void) memset (tFull, 0, fullCard * sizeof(*pFull));
+    else {
+      for (k = 0;  k < fullCard;  k++)
+        tFull[k] = defRec[iField];
+    }
+    tFull += fullCard;
+  }
+} /* initFullVal */
+
 /* getDefRecEqu: return the default record for an equation of type subType
  * Treat unrecognized subType like GMS_EQUTYPE_N, that seems to be the default
  */
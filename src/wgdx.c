@@ -48,6 +48,7 @@ static const char *validSymListNames[] = {
   ,"field"
   ,"varTypeText"
   ,"typeCode"                   /* should this be subType or subTypeCode instead? */
+  ,"layout"
 };
 #define N_VALIDSYMLISTNAMES (sizeof(validSymListNames)/sizeof(*validSymListNames))
 static char validFieldMsg[256] = "";
@@ -335,7 +336,7 @@ getFieldMapping (SEXP val, SEXP labels, SEXP *fVec, wSpec_t *wSpec, int *protCou
     }
     for (i = 0;  i < nRows;  i++) {
       if (pd) {
-        dt = pd[i + nCols*nRows];
+        dt = pd[i + (R_xlen_t)nCols*nRows];
         if (dt < 1) {
           error ("Non-positive coordinates are not allowed in index columns of sparse data");
         }
@@ -348,7 +349,7 @@ getFieldMapping (SEXP val, SEXP labels, SEXP *fVec, wSpec_t *wSpec, int *protCou
         }
       }
       else {
-        k = pi[i + nCols*nRows];
+        k = pi[i + (R_xlen_t)nCols*nRows];
         if (k < 1) {
           error ("Non-positive coordinates are not allowed in index columns of sparse data");
         }
@@ -449,6 +450,56 @@ getFieldMapping (SEXP val, SEXP labels, SEXP *fVec, wSpec_t *wSpec, int *protCou
   }
 } /* getFieldMapping */
 
+/* getWideFieldMapping: for layout='wide', map the value columns of
+ * sparse 'val' to GMS_VAL_XXX using the field names in fieldExp:
+ * 'all' (the default) or distinct fields, e.g. c('l','m'), as rgdx returns
+ * return the number of value columns
+ */
+static int
+getWideFieldMapping (SEXP fieldExp, SEXP *fVec, int *protCount)
+{
+  const char *fieldNames[] = {"l", "m", "lo", "up", "s"};
+  const char *fieldName;
+  int *fPtr;
+  int i, j, k, n, isAll;
+
+  isAll = 1;
+  n = GMS_VAL_MAX;
+  if (fieldExp) {
+    if (STRSXP != TYPEOF(fieldExp))
+      error ("Optional input list element 'field' must be a string vector.");
+    n = length(fieldExp);
+    isAll = (1 == n) && (0 == strcasecmp("all", CHAR(STRING_ELT(fieldExp, 0))));
+    if (isAll)
+      n = GMS_VAL_MAX;
+    else if ((n < 1) || (n > GMS_VAL_MAX))
+      error ("Optional input list element 'field' must be 'all' or a vector of"
+             " distinct fields with layout='wide'.");
+  }
+  PROTECT((*fVec) = allocVector(INTSXP, n));
+  ++*protCount;
+  fPtr = INTEGER(*fVec);
+  for (i = 0;  i < n;  i++) {
+    if (isAll) {
+      fPtr[i] = i;              /* l,m,lo,up,s */
+      continue;
+    }
+    fieldName = CHAR(STRING_ELT(fieldExp, i));
+    for (k = 0;  k < GMS_VAL_MAX;  k++) {
+      if (0 == strcasecmp(fieldNames[k], fieldName))
+        break;
+    }
+    if (k >= GMS_VAL_MAX)
+      error ("variable/equation field name '%s' not valid", fieldName);
+    for (j = 0;  j < i;  j++) {
+      if (fPtr[j] == k)
+        error ("duplicate field label '%s' detected", fieldName);
+    }
+    fPtr[i] = k;
+  }
+  return n;
+} /* getWideFieldMapping */
+
 /* checkVals: check validity of set index columns in input 'val'
  * no return: calls error() if not valid
  * checks include:
@@ -495,7 +546,9 @@ checkVals (SEXP val, SEXP uels, wSpec_t *wSpec, int *isSorted)
       break;
     case variable:
     case equation:
-      nCols -= 2;   /* skip last two columns: field index and level/marginal/etc values */
+      /* skip last two columns: field index and level/marginal/etc values,
+       * or one value column per field with layout='wide' */
+      nCols -= wSpec->nValCols;
       break;
     default:
       error ("vals input not expected/implemented for this symbol type.");
@@ -510,7 +563,7 @@ checkVals (SEXP val, SEXP uels, wSpec_t *wSpec, int *isSorted)
     for (i = 0;  i < nRows;  i++) {
       for (j = 0;  j < nCols;  j++) {
         if (pd) {
-          dt = pd[i + j*nRows];
+          dt = pd[i + (R_xlen_t)j*nRows];
           if (dt < 1) {
             error ("Non-positive coordinates are not allowed in index columns of sparse data");
           }
@@ -523,7 +576,7 @@ checkVals (SEXP val, SEXP uels, wSpec_t *wSpec, int *isSorted)
           }
         }
         else {
-          k = pi[i + j*nRows];
+          k = pi[i + (R_xlen_t)j*nRows];
           if (k < 1) {
             error ("Non-positive coordinates are not allowed in index columns of sparse data");
           }
@@ -649,7 +702,7 @@ sortVals (SEXP val, wSpec_t *wSpec, int *protCount, SEXP *rowPerm)
     break;
   case variable:
   case equation:
-    nCols -= 2;   /* skip last two columns: field index and level/marginal/etc values */
+    nCols -= wSpec->nValCols;   /* skip field index and value cols */
     break;
   default:
     error ("vals input not expected/implemented for this symbol type.");
@@ -700,8 +753,8 @@ createUelOut(SEXP val, SEXP uelOut, dType_t dType, dForm_t dForm)
       for (j = 0;  j < nCols;  j++) {
         mx = 0;
         for (i = 0;  i < nRows;  i++) {
-          if (P[i + j*nRows] > mx) {
-            mx = (int) P[i + j*nRows];
+          if (P[i + (R_xlen_t)j*nRows] > mx) {
+            mx = (int) P[i + (R_xlen_t)j*nRows];
           }
         }
         PROTECT(bufferUel = allocVector(STRSXP, mx));
@@ -719,8 +772,8 @@ createUelOut(SEXP val, SEXP uelOut, dType_t dType, dForm_t dForm)
       for (j = 0;  j < nCols;  j++) {
         mx = 0;
         for (i = 0;  i < nRows;  i++) {
-          if (intVal[i + j*nRows] > mx) {
-            mx = intVal[i + j*nRows];
+          if (intVal[i + (R_xlen_t)j*nRows] > mx) {
+            mx = intVal[i + (R_xlen_t)j*nRows];
           }
         }
         PROTECT(bufferUel = allocVector(STRSXP, mx));
@@ -986,6 +1039,7 @@ readWgdxList (SEXP lst, int iSym, SEXP uelIndex, SEXP fieldIndex, SEXP rowPerms,
   SEXP domExp = NULL;
   SEXP domInfoExp = NULL;
   SEXP fieldExp = NULL;
+  SEXP layoutExp = NULL;
   SEXP typeCodeExp = NULL;
   int i, j;
   int nElements;                /* number of elements in lst */
@@ -1071,6 +1125,9 @@ readWgdxList (SEXP lst, int iSym, SEXP uelIndex, SEXP fieldIndex, SEXP rowPerms,
     else if (0 == strcmp("typeCode", eltName)) {
       typeCodeExp = VECTOR_ELT(lst, i);
     }
+    else if (0 == strcmp("layout", eltName)) {
+      layoutExp = VECTOR_ELT(lst, i);
+    }
     else if (0 == strcmp("varTypeText", eltName)) {
       /* we just ignore this: allowed for rgdx() compatibility */
     }
@@ -1145,6 +1202,28 @@ readWgdxList (SEXP lst, int iSym, SEXP uelIndex, SEXP fieldIndex, SEXP rowPerms,
     strcpy (typeName, tmpName);
   }
 
+  /* sparse 'val' for variables and equations ends with the field index
+   * and value columns, or with layout='wide' with one value column per field */
+  wSpec->nValCols = 2;
+  if (layoutExp) {
+    if (STRSXP != TYPEOF(layoutExp)) {
+      error ("Input list element 'layout' must be a string - found %s instead.",
+             typeofTxt(layoutExp, buf));
+    }
+    tmpName = CHAR(STRING_ELT(layoutExp, 0));
+    if (0 == strcasecmp("wide", tmpName)) {
+      if ((variable != wSpec->dType) && (equation != wSpec->dType))
+        error ("Input list element 'layout'='wide' is only allowed for variables and equations.");
+      if (sparse != wSpec->dForm)
+        error ("Input list element 'layout'='wide' requires form='sparse'.");
+      wSpec->wide = 1;
+      wSpec->nValCols = getWideFieldMapping (fieldExp, &fVec, protCount);
+    }
+    else if (0 != strcasecmp("long", tmpName)) {
+      error ("Input list element 'layout' must be either 'long' or 'wide'.");
+    }
+  } /* layoutExp */
+
   if (aliasForExp) {
     if (STRSXP != TYPEOF(aliasForExp)) {
       error ("Input list element 'aliasFor' must be a string - found %s instead.",
@@ -1204,7 +1283,11 @@ readWgdxList (SEXP lst, int iSym, SEXP uelIndex, SEXP fieldIndex, SEXP rowPerms,
         break;
       case variable:
       case equation:
-        if (wSpec->dim != (dimUels-1))
+        /* no field labels in 'uels' with layout='wide' */
+        if (wSpec->wide && (wSpec->dim != dimUels))
+          error ("Inconsistent dimension found: 'dim'=%d  doesn't match 'uels' dimension=%d.",
+                 wSpec->dim, dimUels);
+        if (! wSpec->wide && (wSpec->dim != (dimUels-1)))
           error ("Inconsistent dimension found: 'dim'=%d  doesn't match implied 'uels' dimension=%d.",
                  wSpec->dim, dimUels-1);
         break;
@@ -1221,7 +1304,7 @@ readWgdxList (SEXP lst, int iSym, SEXP uelIndex, SEXP fieldIndex, SEXP rowPerms,
         break;
       case variable:
       case equation:
-        wSpec->symDim = dimUels - 1;
+        wSpec->symDim = wSpec->wide ? dimUels : dimUels - 1;
         break;
       default:
         error ("uels input not expected/implemented for type=%s.", typeName);
@@ -1299,9 +1382,10 @@ readWgdxList (SEXP lst, int iSym, SEXP uelIndex, SEXP fieldIndex, SEXP rowPerms,
           break;
         case variable:
         case equation:
-          symDimTmp -= 2;
+          symDimTmp -= wSpec->nValCols;
           if (symDimTmp < 0)
-            error ("val input must have at least 2 cols when writing variables in sparse form.");
+            error ("val input must have at least %d cols when writing variables in sparse form.",
+                   wSpec->nValCols);
           break;
         default:
           error ("val input not expected/implemented for type=%s.", typeName);
@@ -1397,7 +1481,9 @@ readWgdxList (SEXP lst, int iSym, SEXP uelIndex, SEXP fieldIndex, SEXP rowPerms,
              typeofTxt(fieldExp, buf));
     }
     checkSymType4 (wSpec->dType, __LINE__);
-    if ((variable == wSpec->dType) || (equation == wSpec->dType)) {
+    /* with layout='wide', the fields were checked above */
+    if (! wSpec->wide &&
+        ((variable == wSpec->dType) || (equation == wSpec->dType))) {
       tmpName = CHAR(STRING_ELT(fieldExp, 0));
       if (0 != strcasecmp("all", tmpName)) {
         error ("Optional input list element 'field' must be 'all':"
@@ -1518,7 +1604,8 @@ readWgdxList (SEXP lst, int iSym, SEXP uelIndex, SEXP fieldIndex, SEXP rowPerms,
         /* error ("readWgdxList: go implement a sorter and save in rowPerms"); */
       }
       /* check out field column */
-      getFieldMapping (valExp, VECTOR_ELT(uelsExp, wSpec->symDim), &fVec, wSpec, protCount);
+      if (! wSpec->wide)
+        getFieldMapping (valExp, VECTOR_ELT(uelsExp, wSpec->symDim), &fVec, wSpec, protCount);
       break;
     default:
       error ("checkVals not implemented type=%s.", typeName);
@@ -1693,7 +1780,8 @@ writeGdx (char *gdxFileName, int symListLen, SEXP *symList,
   int idx;
   SEXP dimVect;
   int iDim, symDim;
-  int totalElement, nColumns, nRows, index;
+  int nColumns, nRows;
+  R_xlen_t totalElement, index; /* full 'val' may be a long vector */
   int fieldIdx;
   double v;
   double *dimVal, *pd, dt, posInf, negInf;
@@ -1921,19 +2009,19 @@ writeGdx (char *gdxFileName, int symListLen, SEXP *symList,
           for (k = 0;  k < nColumns;  k++) {
             iVec = VECTOR_ELT(iVecVec, k);
             if (pd) {
-              idx = (int) pd[k*nRows + iRow];
+              idx = (int) pd[(R_xlen_t)k*nRows + iRow];
             }
             else {
-              idx = pi[k*nRows + iRow];
+              idx = pi[(R_xlen_t)k*nRows + iRow];
             }
             uelIndices[k] = INTEGER(iVec)[idx-1];
           }
           if (wSpecPtr[iSym]->dType == parameter) {
             if (pd) {
-              vals[0] = pd[nColumns*nRows + iRow];
+              vals[0] = pd[(R_xlen_t)nColumns*nRows + iRow];
             }
             else {
-              vals[0] = pi[nColumns*nRows + iRow];
+              vals[0] = pi[(R_xlen_t)nColumns*nRows + iRow];
             }
             vals[0] = mapSpecVals(sVals, vals[0]);
           }
@@ -1999,7 +2087,7 @@ writeGdx (char *gdxFileName, int symListLen, SEXP *symList,
         else {
           error ("Input list element 'val' must be real or integer.");
         }
-        nColumns -= 2;
+        nColumns -= wSpecPtr[iSym]->nValCols;
         switch (wSpecPtr[iSym]->dType) {
         case variable:
           dtCode = GMS_DT_VAR;
@@ -2022,76 +2110,109 @@ writeGdx (char *gdxFileName, int symListLen, SEXP *symList,
                 wSpecPtr[iSym]->name, getGDXErrorMsg());
         }
 
-        idx = -1;
-        empty = 1;
-        memcpy(vals, defVals, sizeof(vals));
-        for (iRow = 0;  iRow < nRows;  iRow++) {
-          int fieldVal;
-          int ii = rowPermPtr ? rowPermPtr[iRow] : iRow;
+        if (wSpecPtr[iSym]->wide) {
+          /* layout='wide': each row is a record, with a value column per field */
+          for (iRow = 0;  iRow < nRows;  iRow++) {
+            int ii = rowPermPtr ? rowPermPtr[iRow] : iRow;
+            int f;
 
-          for (k = 0;  k < nColumns;  k++) {
+            memcpy(vals, defVals, sizeof(vals));
+            for (k = 0;  k < nColumns;  k++) {
+              if (pd) {
+                idx = (int) pd[(R_xlen_t)k*nRows + ii];
+              }
+              else {
+                idx = pi[(R_xlen_t)k*nRows + ii];
+              }
+              iVec = VECTOR_ELT(iVecVec, k);
+              uelIndices[k] = INTEGER(iVec)[idx-1];
+            }
+            for (f = 0;  f < wSpecPtr[iSym]->nValCols;  f++, k++) {
+              if (pd) {
+                vals[fPtr[f]] = pd[(R_xlen_t)k*nRows + ii];
+              }
+              else {
+                vals[fPtr[f]] = pi[(R_xlen_t)k*nRows + ii];
+              }
+            }
+            rc = gdxDataWriteMap (gdxHandle, uelIndices, vals);
+            if (!rc)
+              error("Error calling gdxDataWriteMap for symbol '%s': %s",
+                    wSpecPtr[iSym]->name, getGDXErrorMsg());
+          } /* end loop over rows */
+        }
+        else {
+          idx = -1;
+          empty = 1;
+          memcpy(vals, defVals, sizeof(vals));
+          for (iRow = 0;  iRow < nRows;  iRow++) {
+            int fieldVal;
+            int ii = rowPermPtr ? rowPermPtr[iRow] : iRow;
+
+            for (k = 0;  k < nColumns;  k++) {
+              if (pd) {
+                idx = (int) pd[(R_xlen_t)k*nRows + ii];
+              }
+              else {
+                idx = pi[(R_xlen_t)k*nRows + ii];
+              }
+              currInd[k] = idx;
+            }
             if (pd) {
-              idx = (int) pd[k*nRows + ii];
+              fieldIdx = (int) pd[(R_xlen_t)k*nRows + ii];
+              k++;
+              v = pd[(R_xlen_t)k*nRows + ii];
             }
             else {
-              idx = pi[k*nRows + ii];
+              fieldIdx = pi[(R_xlen_t)k*nRows + ii];
+              k++;
+              v = pi[(R_xlen_t)k*nRows + ii];
             }
-            currInd[k] = idx;
-          }
-          if (pd) {
-            fieldIdx = (int) pd[k*nRows + ii];
-            k++;
-            v = pd[k*nRows + ii];
-          }
-          else {
-            fieldIdx = pi[k*nRows + ii];
-            k++;
-            v = pi[k*nRows + ii];
-          }
-          fieldVal = fPtr[fieldIdx-1];
-          if (empty) {
-            empty = 0;
-            memcpy (prevInd, currInd, nColumns * sizeof(prevInd[0]));
-            /* Rprintf ("  prevInd = %d  %d\n", prevInd[0], prevInd[1]); */
-          }
-          else {
-            int r = idxCmp(nColumns, prevInd, currInd);
-            if (r > 0) {
-              error ("Internal error: Unsorted input 'val' not handled properly");
+            fieldVal = fPtr[fieldIdx-1];
+            if (empty) {
+              empty = 0;
+              memcpy (prevInd, currInd, nColumns * sizeof(prevInd[0]));
+              /* Rprintf ("  prevInd = %d  %d\n", prevInd[0], prevInd[1]); */
             }
-            /* flush and clear */
-            if (r) {
-              for (k = 0;  k < nColumns;  k++) {
-                iVec = VECTOR_ELT(iVecVec, k);
-                idx = prevInd[k];
-                uelIndices[k] = INTEGER(iVec)[idx-1];
+            else {
+              int r = idxCmp(nColumns, prevInd, currInd);
+              if (r > 0) {
+                error ("Internal error: Unsorted input 'val' not handled properly");
+              }
+              /* flush and clear */
+              if (r) {
+                for (k = 0;  k < nColumns;  k++) {
+                  iVec = VECTOR_ELT(iVecVec, k);
+                  idx = prevInd[k];
+                  uelIndices[k] = INTEGER(iVec)[idx-1];
+                }
+                rc = gdxDataWriteMap (gdxHandle, uelIndices, vals);
+                if (!rc)
+                  error("Error calling gdxDataWriteMap for symbol '%s': %s",
+                        wSpecPtr[iSym]->name, getGDXErrorMsg());
+                memcpy(vals, defVals, sizeof(vals));
+                memcpy (prevInd, currInd, nColumns * sizeof(prevInd[0]));
+                memset (currInd, 0, sizeof(valIndex_t)); /* not really needed */
               }
-              rc = gdxDataWriteMap (gdxHandle, uelIndices, vals);
-              if (!rc)
-                error("Error calling gdxDataWriteMap for symbol '%s': %s",
-                      wSpecPtr[iSym]->name, getGDXErrorMsg());
-              memcpy(vals, defVals, sizeof(vals));
-              memcpy (prevInd, currInd, nColumns * sizeof(prevInd[0]));
-              memset (currInd, 0, sizeof(valIndex_t)); /* not really needed */
             }
-          }
-          vals[fieldVal] = v;
+            vals[fieldVal] = v;
 #if 0
-          Rprintf ("  fieldIdx = %d   GMS_VAL_XX = %d   v = %g\n", fieldIdx, fPtr[fieldIdx-1], v);
+            Rprintf ("  fieldIdx = %d   GMS_VAL_XX = %d   v = %g\n", fieldIdx, fPtr[fieldIdx-1], v);
 #endif
-        } /* end loop over rows */
+          } /* end loop over rows */
 
-        if (! empty) {
-          for (k = 0;  k < nColumns;  k++) {
-            iVec = VECTOR_ELT(iVecVec, k);
-            idx = prevInd[k];
-            uelIndices[k] = INTEGER(iVec)[idx-1];
+          if (! empty) {
+            for (k = 0;  k < nColumns;  k++) {
+              iVec = VECTOR_ELT(iVecVec, k);
+              idx = prevInd[k];
+              uelIndices[k] = INTEGER(iVec)[idx-1];
+            }
+            rc = gdxDataWriteMap (gdxHandle, uelIndices, vals);
+            if (!rc)
+              error("Error calling gdxDataWriteMap for symbol '%s': %s",
+                    wSpecPtr[iSym]->name, getGDXErrorMsg());
           }
-          rc = gdxDataWriteMap (gdxHandle, uelIndices, vals);
-          if (!rc)
-            error("Error calling gdxDataWriteMap for symbol '%s': %s",
-                  wSpecPtr[iSym]->name, getGDXErrorMsg());
-        }
+        } /* if wide .. else .. */
         if (!gdxDataWriteDone(gdxHandle))
           error ("Error calling gdxDataWriteDone for symbol '%s': %s",
                  wSpecPtr[iSym]->name, getGDXErrorMsg());
@@ -2110,7 +2231,7 @@ writeGdx (char *gdxFileName, int symListLen, SEXP *symList,
         dimVals = (symDim > 0) ? INTEGER(dimVect) : NULL;
         for (iDim = 0, totalElement = 1;  iDim < symDim;  iDim++)
           totalElement *= dimVals[iDim];
-        if (length(valData) != totalElement)
+        if (xlength(valData) != totalElement)
           error ("Internal error: data mismatch writing to GDX with form='full'");
         if (wSpecPtr[iSym]->dType == parameter) {
           rc = gdxDataWriteMapStart (gdxHandle, wSpecPtr[iSym]->name, expText,
@@ -2134,11 +2255,11 @@ writeGdx (char *gdxFileName, int symListLen, SEXP *symList,
         else
           error ("internal error: unrecognized valData type");
         for (index = 0; index < totalElement; index++) {
-          int indexTmp = index, totalTmp = totalElement;
+          R_xlen_t indexTmp = index, totalTmp = totalElement;
           for (iDim = symDim-1;  iDim >= 0;  iDim--) {
             iVec = VECTOR_ELT(iVecVec, iDim);
             totalTmp /= dimVals[iDim];
-            idx = indexTmp / totalTmp;
+            idx = (int) (indexTmp / totalTmp);
             uelIndices[iDim] = INTEGER(iVec)[idx];
             indexTmp = indexTmp % totalTmp;
           } /* for loop over "d" */
@@ -2188,7 +2309,7 @@ writeGdx (char *gdxFileName, int symListLen, SEXP *symList,
         for (iDim = 0, totalElement = 1;  iDim < symDim;  iDim++)
           totalElement *= dimVals[iDim];
         fDim = dimVals[iDim];
-        if (length(valData) != (totalElement * fDim))
+        if (xlength(valData) != (totalElement * fDim))
           error ("Internal error: data mismatch writing to GDX with form='full'");
         rc = gdxDataWriteMapStart (gdxHandle, wSpecPtr[iSym]->name, expText,
                                    symDim, GMS_DT_VAR, wSpecPtr[iSym]->typeCode);
@@ -2206,11 +2327,11 @@ writeGdx (char *gdxFileName, int symListLen, SEXP *symList,
         getDefaultVarRec (wSpecPtr[iSym]->typeCode, defVals);
         memcpy(vals, defVals, sizeof(vals));
         for (index = 0; index < totalElement; index++) {
-          int indexTmp = index, totalTmp = totalElement;
+          R_xlen_t indexTmp = index, totalTmp = totalElement;
           for (iDim = symDim-1;  iDim >= 0;  iDim--) {
             iVec = VECTOR_ELT(iVecVec, iDim);
             totalTmp /= dimVals[iDim];
-            idx = indexTmp / totalTmp;
+            idx = (int) (indexTmp / totalTmp);
             uelIndices[iDim] = INTEGER(iVec)[idx];
             indexTmp = indexTmp % totalTmp;
           } /* for loop over "d" */